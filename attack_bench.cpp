@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "attacks.hpp"
+using namespace std;
+
+// the tile by tile blocking scans the board used before the slider tables
+// kept here as the baseline the table lookups are measured against
+struct RayWalkBoard{
+    vector<vector<char>> board;
+
+    explicit RayWalkBoard(Bitboard occupied)
+        : board(8, vector<char>(8, '*')){
+        for (int square = 0; square < 64; square++){
+            if (occupied & square_bb(square)){
+                board[square_x(square)][square_y(square)] = 'P';
+            }
+        }
+    }
+
+    bool piece_blocking_straight_move(int x, int y, int currX, int currY) const{
+        int xDiff = x - currX;
+        int yDiff = y - currY;
+        int xStep = xDiff > 0 ? 1 : (xDiff < 0 ? -1 : 0);
+        int yStep = xDiff != 0 ? 0 : (yDiff > 0 ? 1 : -1);
+        currX += xStep;
+        currY += yStep;
+        while (currX != x || currY != y){
+            if (board[currX][currY] != '*'){
+                return true;
+            }
+            currX += xStep;
+            currY += yStep;
+        }
+        return false;
+    }
+
+    bool piece_blocking_diagnol_move(int x, int y, int currX, int currY) const{
+        int xStep = x > currX ? 1 : -1;
+        int yStep = y > currY ? 1 : -1;
+        currX += xStep;
+        currY += yStep;
+        while (currX != x){
+            if (board[currX][currY] != '*'){
+                return true;
+            }
+            currX += xStep;
+            currY += yStep;
+        }
+        return false;
+    }
+};
+
+// one query of the benchmark: a pair of squares on a shared line and a board occupancy
+struct Query{
+    int from;
+    int to;
+    bool straight;
+    Bitboard occupied;
+    int position;
+};
+
+// times a function over every query and prints ns per call
+// the results are summed into a checksum so the compiler can't drop the calls
+template <typename Function>
+uint64_t time_queries(const string &name, const vector<Query> &queries, int rounds, Function function){
+    uint64_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++){
+        for (const Query &query: queries){
+            checksum += function(query);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double calls = double(queries.size()) * rounds;
+    cout << name << ": " << seconds * 1e9 / calls << " ns/call  " << uint64_t(calls / seconds) << " calls/sec\n";
+    return checksum;
+}
+
+// usage: attack_bench [rounds]
+// compares the slider tables(magic multiplication and, on BMI2 cpus, pext indexing) against
+// walking rays square by square, both for full attack sets and for "is the path between a and b clear"
+int main(int argc, char *argv[]){
+    int rounds = argc > 1 ? stoi(argv[1]) : 200;
+    static const SliderTables magicTables(false);
+    bool havePext = cpu_has_pext();
+
+    // random boards about as full as a middlegame position
+    mt19937_64 random(2024);
+    vector<Bitboard> occupancies;
+    vector<RayWalkBoard> rayBoards;
+    for (int i = 0; i < 64; i++){
+        occupancies.push_back(random() & random());
+        rayBoards.emplace_back(occupancies.back());
+    }
+    vector<Query> queries;
+    for (int i = 0; i < 4096; i++){
+        int from = random() % 64;
+        Bitboard line = slider_attacks(from, 0, ROOK_DIRECTIONS) | slider_attacks(from, 0, BISHOP_DIRECTIONS);
+        int skip = random() % pop_count(line);
+        while (skip--){
+            pop_lsb(line);
+        }
+        int to = lsb(line);
+        bool straight = square_x(from) == square_x(to) || square_y(from) == square_y(to);
+        int position = random() % occupancies.size();
+        queries.push_back({from, to, straight, occupancies[position], position});
+    }
+
+    cout << "path clear between two squares\n";
+    uint64_t walked = time_queries("  ray walk   ", queries, rounds, [&](const Query &q){
+        const RayWalkBoard &board = rayBoards[q.position];
+        int x = square_x(q.to), y = square_y(q.to), currX = square_x(q.from), currY = square_y(q.from);
+        return q.straight ? board.piece_blocking_straight_move(x, y, currX, currY)
+            : board.piece_blocking_diagnol_move(x, y, currX, currY);
+    });
+    uint64_t looked = time_queries("  between    ", queries, rounds, [](const Query &q){
+        return (q.occupied & between_bb(q.from, q.to)) != 0;
+    });
+    cout << (walked == looked ? "  results match\n" : "  RESULTS DIFFER\n");
+
+    cout << "queen attacks from a square\n";
+    uint64_t reference = time_queries("  ray walk   ", queries, rounds, [](const Query &q){
+        return slider_attacks(q.from, q.occupied, ROOK_DIRECTIONS) | slider_attacks(q.from, q.occupied, BISHOP_DIRECTIONS);
+    });
+    uint64_t magic = time_queries("  magic      ", queries, rounds, [&](const Query &q){
+        return magicTables.rook_attacks(q.from, q.occupied) | magicTables.bishop_attacks(q.from, q.occupied);
+    });
+    bool match = reference == magic;
+    if (havePext){
+        static const SliderTables pextTables(true);
+        uint64_t pexted = time_queries("  pext       ", queries, rounds, [&](const Query &q){
+            return pextTables.rook_attacks(q.from, q.occupied) | pextTables.bishop_attacks(q.from, q.occupied);
+        });
+        match = match && reference == pexted;
+    } else {
+        cout << "  pext        not supported by this cpu\n";
+    }
+    cout << (match ? "  results match\n" : "  RESULTS DIFFER\n");
+    cout << "default tables use " << (SLIDERS.uses_pext() ? "pext" : "magic") << " indexing" << endl;
+    return match && walked == looked ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+#ifndef ATTACKS_HPP
+#define ATTACKS_HPP
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "bitboard.hpp"
+
+// tables of the squares attacked by each piece type from each square
+// pawn tables are indexed by team first as white pawns attack towards row 0
+// and red pawns attack towards row 7
+// along with the squares a pawn moves to without taking, one row forward or two from its starting row
+struct AttackTables{
+    Bitboard pawn[2][64];
+    Bitboard pawnPushes[2][64];
+    Bitboard knight[64];
+    Bitboard king[64];
+};
+
+// returns the bitboard of the squares reached by stepping from a square by each of the
+// given row and column offsets, ignoring any step that leaves the board
+constexpr Bitboard leaper_attacks(int square, const int steps[][2], int numSteps){
+    Bitboard attacks = 0;
+    for (int i = 0; i < numSteps; i++){
+        int x = square_x(square) + steps[i][0];
+        int y = square_y(square) + steps[i][1];
+        if (x >= 0 && x <= 7 && y >= 0 && y <= 7){
+            attacks |= square_bb(make_square(x, y));
+        }
+    }
+    return attacks;
+}
+
+// fills the attack tables for every square
+// evaluated by the compiler, so the tables are constants of the program with nothing to set up at startup
+constexpr AttackTables build_attack_tables(){
+    const int whitePawnSteps[2][2] = {{-1, -1}, {-1, 1}};
+    const int redPawnSteps[2][2] = {{1, -1}, {1, 1}};
+    const int knightSteps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+    const int kingSteps[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+    const int whitePushSteps[2][2] = {{-1, 0}, {-2, 0}};
+    const int redPushSteps[2][2] = {{1, 0}, {2, 0}};
+    AttackTables tables{};
+    for (int square = 0; square < 64; square++){
+        tables.pawn[0][square] = leaper_attacks(square, whitePawnSteps, 2);
+        tables.pawn[1][square] = leaper_attacks(square, redPawnSteps, 2);
+        tables.pawnPushes[0][square] = leaper_attacks(square, whitePushSteps, square_x(square) == 6 ? 2 : 1);
+        tables.pawnPushes[1][square] = leaper_attacks(square, redPushSteps, square_x(square) == 1 ? 2 : 1);
+        tables.knight[square] = leaper_attacks(square, knightSteps, 8);
+        tables.king[square] = leaper_attacks(square, kingSteps, 8);
+    }
+    return tables;
+}
+
+inline constexpr AttackTables ATTACKS = build_attack_tables();
+
+// returns squares a pawn of the specified team(0 white, 1 red) attacks from a square
+inline Bitboard pawn_attacks(int team, int square){
+    return ATTACKS.pawn[team][square];
+}
+
+// returns squares a pawn of the specified team moves to from a square when not taking
+// on an empty board
+inline Bitboard pawn_pushes(int team, int square){
+    return ATTACKS.pawnPushes[team][square];
+}
+
+// returns squares a knight attacks from a square
+inline Bitboard knight_attacks(int square){
+    return ATTACKS.knight[square];
+}
+
+// returns squares a king attacks from a square
+inline Bitboard king_attacks(int square){
+    return ATTACKS.king[square];
+}
+
+// returns squares a sliding piece attacks from a square by walking each of the given
+// directions until the edge of the board or the first occupied square, which is included
+// only used to fill the slider tables below
+inline Bitboard slider_attacks(int square, Bitboard occupied, const int directions[4][2]){
+    Bitboard attacks = 0;
+    for (int i = 0; i < 4; i++){
+        int x = square_x(square) + directions[i][0];
+        int y = square_y(square) + directions[i][1];
+        while (x >= 0 && x <= 7 && y >= 0 && y <= 7){
+            Bitboard bb = square_bb(make_square(x, y));
+            attacks |= bb;
+            if (occupied & bb){
+                break;
+            }
+            x += directions[i][0];
+            y += directions[i][1];
+        }
+    }
+    return attacks;
+}
+
+const int ROOK_DIRECTIONS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+const int BISHOP_DIRECTIONS[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+
+#if defined(__x86_64__) || defined(__i386__)
+// parallel bit extract instruction of BMI2 cpus
+// compiled for BMI2 regardless of build flags and only called once the cpu is known to support it
+__attribute__((target("bmi2"))) inline uint64_t pext(uint64_t bits, uint64_t mask){
+    return _pext_u64(bits, mask);
+}
+
+// returns if the cpu running the program has the pext instruction
+inline bool cpu_has_pext(){
+    return __builtin_cpu_supports("bmi2");
+}
+#else
+// pext one bit at a time for cpus without the instruction, the tables use magic multiplication there
+inline uint64_t pext(uint64_t bits, uint64_t mask){
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask; bit <<= 1){
+        if (bits & mask & -mask){
+            result |= bit;
+        }
+        mask &= mask - 1;
+    }
+    return result;
+}
+
+inline bool cpu_has_pext(){
+    return false;
+}
+#endif
+
+// magic multipliers of each square that map every relevant occupancy of a rook or bishop
+// to a distinct table index(or to an index holding the same attacks)
+// found once by trying sparse random numbers and kept here so no search is done at startup
+const Bitboard ROOK_MAGICS[64] = {
+    0x1080004008801020ull, 0x0840092002c03000ull, 0x1900200010400900ull, 0x0880100008000480ull,
+    0x4200100420080200ull, 0x8100020100080400ull, 0x0200040110886200ull, 0x0200008040220411ull,
+    0x0404800084400220ull, 0x0000401000402000ull, 0x0086001081220440ull, 0x0408800800100280ull,
+    0x000a001201040820ull, 0x8848800200840080ull, 0x4001000100040200ull, 0x0442000102105084ull,
+    0x9080010020804100ull, 0x0040404000201009ull, 0x0000808010002009ull, 0x2200090021d00100ull,
+    0x0008008008040080ull, 0x0004004002010040ull, 0x0011040008015042ull, 0x00000a0001768104ull,
+    0x0000800080204009ull, 0x2010004140002001ull, 0x9800200280100080ull, 0x1000100080080080ull,
+    0x0442000a00049020ull, 0x2100040080020080ull, 0x0800120400900148ull, 0x0010040a00128541ull,
+    0x2800804000800030ull, 0x1010002000400041ull, 0x4000200011004100ull, 0x0610008410800800ull,
+    0x0400802402800800ull, 0xc100020080800400ull, 0x0002000802000401ull, 0x0182085882000401ull,
+    0x0220204000808000ull, 0x2860100040024022ull, 0x0001002004110040ull, 0x99101042000a0020ull,
+    0x0004080004008080ull, 0x0010040002008080ull, 0x2012004881020004ull, 0x8300842444820011ull,
+    0x0088403882010200ull, 0x0820400080210100ull, 0x0110910040a00300ull, 0x0801100280080480ull,
+    0x0242009008200600ull, 0x1002000489500200ull, 0x0040800200010080ull, 0x0091800041000080ull,
+    0x0000209300488001ull, 0x04c1002414824001ull, 0x020020000b001041ull, 0x7000100004200901ull,
+    0x8002002004100802ull, 0x30010002084c0007ull, 0x0888221800813004ull, 0x4000002840840112ull
+};
+
+const Bitboard BISHOP_MAGICS[64] = {
+    0x10102002004a1420ull, 0x8020040400584008ull, 0x10510800811201c8ull, 0x5204042080000088ull,
+    0x2204106880000002ull, 0x1401042004000000ull, 0x0400880410042004ull, 0x0028208200a02020ull,
+    0x1500241990010e00ull, 0x8001200182020a40ull, 0x40004101030b0000ull, 0x8002041042000100ull,
+    0x4010011041020038ull, 0x0000010421044000ull, 0x1500210808020a00ull, 0x8000088400880520ull,
+    0x0405004010040100ull, 0x1005823210040108ull, 0x2708008102040011ull, 0x4048200404009100ull,
+    0x0018104101400024ull, 0x0003000601190101ull, 0x8004803108491000ull, 0x8014241200820800ull,
+    0x0006e080100c3040ull, 0x0501044a11041800ull, 0x9020300008004045ull, 0x0894080000220040ull,
+    0x1001010083104000ull, 0x5004030040900080ull, 0x000400422c012400ull, 0x0002128698404812ull,
+    0x1010108404900440ull, 0x0928021182084100ull, 0x2006080409020024ull, 0x1010202020180080ull,
+    0xa010008200202200ull, 0x2098015100019004ull, 0x0002041440810811ull, 0x802a02020000b098ull,
+    0x0009015090004060ull, 0x4000821082081001ull, 0x0100210040420800ull, 0x0800004010488a00ull,
+    0x2000081104004040ull, 0x4c8e029015000082ull, 0x0420340322224842ull, 0x1298260043400210ull,
+    0x0000822802400008ull, 0x00008a0101600000ull, 0x3040003412080021ull, 0x3040290220884800ull,
+    0x4a1500401041004aull, 0x8010200282020781ull, 0x0020203142209091ull, 0x0070300600902110ull,
+    0x0040808800b62048ull, 0x0000810400c44420ull, 0x00080400440c0441ull, 0x8340080020840411ull,
+    0x0000000104208200ull, 0x0000800810d00080ull, 0x0400530411080200ull, 0x4040702400932244ull
+};
+
+// lookup entry of one slider on one square
+// only the relevant occupancy(the squares of the piece's rays minus the last square of each ray,
+// which can't block anything) changes the attacks, and it is turned into a dense table index
+// either by a magic multiply and shift or by a single pext on BMI2 cpus
+struct SliderMagic{
+    Bitboard *attacks;
+    Bitboard mask;
+    Bitboard magic;
+    unsigned shift;
+};
+
+// precomputed sliding piece attacks for every square and relevant occupancy
+// plus the squares strictly between any two squares sharing a row, column or diagonal
+// and the whole line through them
+class SliderTables{
+    Bitboard rookTable[0x19000];
+    Bitboard bishopTable[0x1480];
+    SliderMagic rookMagics[64];
+    SliderMagic bishopMagics[64];
+    Bitboard between[64][64];
+    Bitboard line[64][64];
+    bool usePext;
+
+    // returns the attacks stored for the relevant occupancy of the board
+    Bitboard lookup(const SliderMagic &entry, Bitboard occupied) const{
+        if (usePext){
+            return entry.attacks[pext(occupied, entry.mask)];
+        }
+        return entry.attacks[((occupied & entry.mask) * entry.magic) >> entry.shift];
+    }
+
+    // fills the lookup entries and attack table of one slider type
+    void init_slider(SliderMagic entries[64], Bitboard *table, const Bitboard magics[64], const int directions[4][2]){
+        for (int square = 0; square < 64; square++){
+            Bitboard edges = ((row_bb(0) | row_bb(7)) & ~row_bb(square_x(square)))
+                | ((col_bb(0) | col_bb(7)) & ~col_bb(square_y(square)));
+            SliderMagic &entry = entries[square];
+            entry.mask = slider_attacks(square, 0, directions) & ~edges;
+            entry.magic = magics[square];
+            entry.shift = 64 - pop_count(entry.mask);
+            entry.attacks = table;
+
+            // enumerate every subset of the mask with the carry rippler trick
+            Bitboard occupied = 0;
+            do {
+                entry.attacks[usePext ? pext(occupied, entry.mask) : (occupied * entry.magic) >> entry.shift]
+                    = slider_attacks(square, occupied, directions);
+                occupied = (occupied - entry.mask) & entry.mask;
+            } while (occupied);
+            table += Bitboard(1) << pop_count(entry.mask);
+        }
+    }
+
+    // fills the squares between a square and every square it shares a line with
+    // the squares seen from both ends, with the other end as the only blocker, lie between them
+    void init_between(int from, const int directions[4][2]){
+        Bitboard rays = slider_attacks(from, 0, directions);
+        while (rays){
+            int to = pop_lsb(rays);
+            between[from][to] = slider_attacks(from, square_bb(to), directions)
+                & slider_attacks(to, square_bb(from), directions);
+        }
+    }
+
+    // fills the whole line through a square and every square it shares a line with, once the squares
+    // between are known: the two squares, the squares between them and every square beyond either end
+    void init_line(int from, const int directions[4][2]){
+        Bitboard rays = slider_attacks(from, 0, directions);
+        while (rays){
+            int to = pop_lsb(rays);
+            line[from][to] = square_bb(from) | square_bb(to) | between[from][to];
+            for (int beyond = 0; beyond < 64; beyond++){
+                if ((between[from][beyond] & square_bb(to)) || (between[to][beyond] & square_bb(from))){
+                    line[from][to] |= square_bb(beyond);
+                }
+            }
+        }
+    }
+
+    public:
+    // builds tables indexed by pext when usePext is set, which requires a BMI2 cpu,
+    // otherwise by magic multiplication
+    explicit SliderTables(bool usePext)
+        : between{}, line{}, usePext{usePext} {
+        init_slider(rookMagics, rookTable, ROOK_MAGICS, ROOK_DIRECTIONS);
+        init_slider(bishopMagics, bishopTable, BISHOP_MAGICS, BISHOP_DIRECTIONS);
+        for (int square = 0; square < 64; square++){
+            init_between(square, ROOK_DIRECTIONS);
+            init_between(square, BISHOP_DIRECTIONS);
+        }
+        for (int square = 0; square < 64; square++){
+            init_line(square, ROOK_DIRECTIONS);
+            init_line(square, BISHOP_DIRECTIONS);
+        }
+    }
+
+    Bitboard rook_attacks(int square, Bitboard occupied) const{
+        return lookup(rookMagics[square], occupied);
+    }
+
+    Bitboard bishop_attacks(int square, Bitboard occupied) const{
+        return lookup(bishopMagics[square], occupied);
+    }
+
+    Bitboard between_bb(int from, int to) const{
+        return between[from][to];
+    }
+
+    Bitboard line_bb(int from, int to) const{
+        return line[from][to];
+    }
+
+    bool uses_pext() const{
+        return usePext;
+    }
+};
+
+// pext is chosen when the cpu running the program supports it
+inline const SliderTables SLIDERS(cpu_has_pext());
+
+// returns squares a rook attacks from a square given the occupied squares of the board
+inline Bitboard rook_attacks(int square, Bitboard occupied){
+    return SLIDERS.rook_attacks(square, occupied);
+}
+
+// returns squares a bishop attacks from a square given the occupied squares of the board
+inline Bitboard bishop_attacks(int square, Bitboard occupied){
+    return SLIDERS.bishop_attacks(square, occupied);
+}
+
+// returns squares a queen attacks from a square given the occupied squares of the board
+inline Bitboard queen_attacks(int square, Bitboard occupied){
+    return rook_attacks(square, occupied) | bishop_attacks(square, occupied);
+}
+
+// returns the squares strictly between two squares on the same row, column or diagonal
+// or an empty bitboard if the squares don't share a line
+inline Bitboard between_bb(int from, int to){
+    return SLIDERS.between_bb(from, to);
+}
+
+// returns every square of the row, column or diagonal through two squares, edge to edge
+// or an empty bitboard if the squares don't share a line
+inline Bitboard line_bb(int from, int to){
+    return SLIDERS.line_bb(from, to);
+}
+
+#endif
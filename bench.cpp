@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "movegen.hpp"
+#include "player.hpp"
+using namespace std;
+
+// a player of the benchmark, which can look up its pieces to build queries
+class CorpusPlayer: public Player{
+    public:
+    using Player::Player;
+
+    Piece *piece_at(int square){
+        return pieces.return_piece_at_pos(square_x(square), square_y(square));
+    }
+};
+
+// a position of the corpus with both players' piece sets set up to match it
+struct CorpusPosition{
+    unique_ptr<Board> board;
+    unique_ptr<CorpusPlayer> toMove;
+    unique_ptr<CorpusPlayer> other;
+
+    explicit CorpusPosition(const Board &position)
+        : board(new Board(position)), toMove(new CorpusPlayer(team_name(position.side_to_move()), "to move")),
+          other(new CorpusPlayer(team_name(TileOwner(position.side_to_move() ^ 1)), "other")){
+        toMove->set_position(*board);
+        other->set_position(*board);
+    }
+
+    static string team_name(TileOwner team){
+        return team == white ? "white" : "red";
+    }
+};
+
+// the fixed corpus: the standard perft positions, a few checkmates, positions along seeded random
+// games and every position of those games with the side to move in check, so check_mate gets past
+// its first test
+// the games only depend on the seed and the move generator, so every build benchmarks the same positions
+vector<CorpusPosition> build_corpus(){
+    const vector<string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        // checkmates by a queen, a rook along the back row and a knight
+        "r1bqkb1r/pppp1Qpp/2n2n2/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 0 4",
+        "R5k1/5ppp/8/8/8/8/5PPP/6K1 b - - 0 1",
+        "6rk/5Npp/8/8/8/8/5PPP/6K1 b - - 0 1",
+    };
+    vector<CorpusPosition> corpus;
+    for (const string &fen: fens){
+        corpus.emplace_back(Board(fen));
+    }
+    mt19937_64 random(2024);
+    unique_ptr<Board> board(new Board());
+    int inCheck = 0;
+    for (int game = 0; game < 64; game++){
+        *board = Board();
+        for (int ply = 0; ply < 120; ply++){
+            MoveList moves;
+            generate_legal_moves(*board, moves);
+            if (moves.size() == 0){
+                if (board->in_check()){
+                    corpus.emplace_back(*board);
+                }
+                break;
+            }
+            if (ply % 20 == 10 || (board->in_check() && inCheck < 64)){
+                inCheck += board->in_check();
+                corpus.emplace_back(*board);
+            }
+            board->play_move(moves[random() % moves.size()]);
+        }
+    }
+    return corpus;
+}
+
+// timings of one benchmark over its samples
+struct BenchResult{
+    string name;
+    uint64_t ops = 0;
+    uint64_t checksum = 0;
+    vector<double> samples;
+    double mean = 0;
+    double variance = 0;
+    double best = 0;
+};
+
+// runs every query of a benchmark `rounds` times per sample and records the ns/op of each sample
+// the rounds are picked so a sample takes about sampleMs milliseconds, after one sample to warm up
+// the query results are summed into the checksum so the compiler can't drop the calls, and as the
+// corpus is fixed the checksum only changes when the rules give different answers
+BenchResult run_benchmark(const string &name, size_t queries, const function<uint64_t()> &pass, int samples, double sampleMs){
+    BenchResult result;
+    result.name = name;
+    auto start = chrono::steady_clock::now();
+    result.checksum = pass();
+    double once = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    int rounds = max(1, int(sampleMs / max(once, 1e-6)));
+    for (int sample = 0; sample < samples; sample++){
+        uint64_t checksum = 0;
+        start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++){
+            checksum += pass();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (checksum != result.checksum * rounds){
+            throw runtime_error(name + " gave different results on the same positions");
+        }
+        result.samples.push_back(seconds * 1e9 / (double(queries) * rounds));
+    }
+    result.ops = uint64_t(queries) * rounds * samples;
+    for (double sample: result.samples){
+        result.mean += sample / samples;
+    }
+    for (double sample: result.samples){
+        result.variance += (sample - result.mean) * (sample - result.mean) / max(samples - 1, 1);
+    }
+    result.best = *min_element(result.samples.begin(), result.samples.end());
+    return result;
+}
+
+string to_json(const vector<BenchResult> &results, size_t positions){
+    ostringstream json;
+    json << setprecision(6) << "{\n  \"positions\": " << positions << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++){
+        const BenchResult &result = results[i];
+        json << "    {\"name\": \"" << result.name << "\", \"ops\": " << result.ops
+             << ", \"samples\": " << result.samples.size() << ", \"ns_per_op\": " << result.mean
+             << ", \"min_ns_per_op\": " << result.best << ", \"ops_per_sec\": " << 1e9 / result.mean
+             << ", \"variance\": " << result.variance << ", \"stddev\": " << sqrt(result.variance)
+             << ", \"checksum\": " << result.checksum << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+// the value of a numeric field of a JSON object written by to_json, or NAN if it is missing
+double json_number(const string &object, const string &field){
+    size_t at = object.find("\"" + field + "\":");
+    if (at == string::npos){
+        return NAN;
+    }
+    return strtod(object.c_str() + at + field.size() + 3, nullptr);
+}
+
+// reads the benchmarks of a file written by --json as name, ns/op and checksum
+// throws std::runtime_error if the file can't be read or has no benchmarks
+vector<BenchResult> read_baseline(const string &path){
+    ifstream file(path);
+    if (!file){
+        throw runtime_error("could not open baseline " + path);
+    }
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    vector<BenchResult> baseline;
+    size_t at = 0;
+    while ((at = text.find("{\"name\": \"", at)) != string::npos){
+        size_t nameStart = at + 10;
+        size_t end = text.find('}', nameStart);
+        string object = text.substr(at, end - at);
+        BenchResult result;
+        result.name = text.substr(nameStart, text.find('"', nameStart) - nameStart);
+        result.mean = json_number(object, "ns_per_op");
+        result.variance = json_number(object, "variance");
+        size_t checksum = object.find("\"checksum\":");
+        if (isnan(result.mean) || checksum == string::npos){
+            throw runtime_error("baseline " + path + " is missing fields of " + result.name);
+        }
+        result.checksum = strtoull(object.c_str() + checksum + 11, nullptr, 10);
+        baseline.push_back(result);
+        at = end;
+    }
+    if (baseline.empty()){
+        throw runtime_error("no benchmarks found in baseline " + path);
+    }
+    return baseline;
+}
+
+// usage: bench [--samples N] [--sample-ms MS] [--json FILE] [--baseline FILE] [--threshold PERCENT]
+// times the rules functions the human game calls on every move(move_piece_possible, check, check_mate,
+// piece_in_way and the board's blocking scans) over a fixed corpus of positions and prints ns/op,
+// ops/sec and the variance of ns/op over N(default 10) samples of about MS(default 50) milliseconds
+// --json writes the results as JSON, "-" for stdout, to keep as a baseline
+// --baseline compares against a file written by --json and returns 1 if a benchmark is more than
+// PERCENT(default 10) slower or any gives different results than the baseline did
+int main(int argc, char *argv[]){
+    int samples = 10;
+    double sampleMs = 50;
+    double threshold = 10;
+    string jsonFile;
+    string baselineFile;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc){
+            samples = max(2, stoi(argv[++i]));
+        } else if (strcmp(argv[i], "--sample-ms") == 0 && i + 1 < argc){
+            sampleMs = stod(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc){
+            jsonFile = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc){
+            baselineFile = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc){
+            threshold = stod(argv[++i]);
+        } else {
+            cerr << "unknown argument " << argv[i] << endl;
+            return 1;
+        }
+    }
+    vector<BenchResult> baseline;
+    try{
+        if (!baselineFile.empty()){
+            baseline = read_baseline(baselineFile);
+        }
+    } catch (const runtime_error &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    vector<CorpusPosition> corpus = build_corpus();
+    // the queries of each benchmark, built once so only the calls are timed
+    // piece_in_way: every piece of either side to every square its type can move to on an empty board
+    // move_piece_possible: the same for the side to move, so most queries get as far as the check test
+    // blocking scans: every pair of squares sharing a row or column, or a diagonal
+    struct PieceQuery{
+        CorpusPosition *position;
+        const Piece *piece;
+        bool toMove;
+        int x;
+        int y;
+    };
+    struct ScanQuery{
+        const Board *board;
+        int x;
+        int y;
+        int currX;
+        int currY;
+    };
+    vector<PieceQuery> movePieceQueries, pieceInWayQueries;
+    vector<ScanQuery> straightQueries, diagonalQueries;
+    for (CorpusPosition &position: corpus){
+        for (int square = 0; square < 64; square++){
+            if (position.board->owner_at(square) == nobody){
+                continue;
+            }
+            bool toMove = position.board->owner_at(square) == position.board->side_to_move();
+            const Piece *piece = (toMove ? position.toMove : position.other)->piece_at(square);
+            for (int to = 0; to < 64; to++){
+                if (piece->update_pos_possible(square_x(to), square_y(to))){
+                    pieceInWayQueries.push_back({&position, piece, toMove, square_x(to), square_y(to)});
+                    if (toMove){
+                        movePieceQueries.push_back({&position, piece, true, square_x(to), square_y(to)});
+                    }
+                }
+            }
+        }
+        for (int from = 0; from < 64; from++){
+            for (int to = 0; to < 64; to++){
+                int xDiff = square_x(to) - square_x(from);
+                int yDiff = square_y(to) - square_y(from);
+                ScanQuery query{position.board.get(), square_x(to), square_y(to), square_x(from), square_y(from)};
+                if ((xDiff == 0) != (yDiff == 0)){
+                    straightQueries.push_back(query);
+                } else if (xDiff != 0 && abs(xDiff) == abs(yDiff)){
+                    diagonalQueries.push_back(query);
+                }
+            }
+        }
+    }
+
+    vector<BenchResult> results;
+    try{
+        results.push_back(run_benchmark("move_piece_possible", movePieceQueries.size(), [&](){
+            uint64_t possible = 0;
+            for (const PieceQuery &q: movePieceQueries){
+                possible += q.position->toMove->move_piece_possible(*q.position->board, q.piece, *q.position->other,
+                    q.x, q.y, false);
+            }
+            return possible;
+        }, samples, sampleMs));
+        // both players' kings, as the game asks after every move
+        results.push_back(run_benchmark("check", corpus.size() * 2, [&](){
+            uint64_t checks = 0;
+            for (CorpusPosition &position: corpus){
+                for (bool toMove: {true, false}){
+                    Player &player = toMove ? *position.toMove : *position.other;
+                    Player &opponent = toMove ? *position.other : *position.toMove;
+                    int kingSquare = position.board->king_square(TileOwner(position.board->side_to_move() ^ !toMove));
+                    checks += player.check(opponent, *position.board, square_x(kingSquare), square_y(kingSquare));
+                }
+            }
+            return checks;
+        }, samples, sampleMs));
+        results.push_back(run_benchmark("check_mate", corpus.size(), [&](){
+            uint64_t mates = 0;
+            for (CorpusPosition &position: corpus){
+                mates += position.toMove->check_mate(*position.other, *position.board);
+            }
+            return mates;
+        }, samples, sampleMs));
+        results.push_back(run_benchmark("piece_in_way", pieceInWayQueries.size(), [&](){
+            uint64_t blocked = 0;
+            for (const PieceQuery &q: pieceInWayQueries){
+                const Player &player = q.toMove ? *q.position->toMove : *q.position->other;
+                const Player &opponent = q.toMove ? *q.position->other : *q.position->toMove;
+                blocked += player.piece_in_way(opponent, *q.position->board, q.piece, q.x, q.y);
+            }
+            return blocked;
+        }, samples, sampleMs));
+        results.push_back(run_benchmark("piece_blocking_straight_move", straightQueries.size(), [&](){
+            uint64_t blocked = 0;
+            for (const ScanQuery &q: straightQueries){
+                blocked += q.board->piece_blocking_straight_move(q.x, q.y, q.currX, q.currY);
+            }
+            return blocked;
+        }, samples, sampleMs));
+        results.push_back(run_benchmark("piece_blocking_diagnol_move", diagonalQueries.size(), [&](){
+            uint64_t blocked = 0;
+            for (const ScanQuery &q: diagonalQueries){
+                blocked += q.board->piece_blocking_diagnol_move(q.x, q.y, q.currX, q.currY);
+            }
+            return blocked;
+        }, samples, sampleMs));
+    } catch (const runtime_error &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    string json = to_json(results, corpus.size());
+    if (jsonFile == "-"){
+        cout << json;
+    } else {
+        cout << corpus.size() << " positions, " << samples << " samples each\n" << fixed << setprecision(1);
+        for (const BenchResult &result: results){
+            cout << result.name << string(30 - result.name.size(), ' ') << setw(10) << result.mean << " ns/op  "
+                 << setw(12) << uint64_t(1e9 / result.mean) << " ops/sec  stddev " << sqrt(result.variance)
+                 << " ns  min " << result.best << " ns\n";
+        }
+        if (!jsonFile.empty()){
+            ofstream file(jsonFile);
+            file << json;
+            if (!file){
+                cerr << "could not write " << jsonFile << endl;
+                return 1;
+            }
+            cout << "wrote the results to " << jsonFile << "\n";
+        }
+    }
+    if (baseline.empty()){
+        return 0;
+    }
+
+    // a benchmark is slower or faster when its mean moved by more than the threshold
+    // and by more than twice the combined standard deviation of both runs
+    bool regressed = false;
+    ostream &out = jsonFile == "-" ? cerr : cout;
+    out << "against " << baselineFile << "\n" << fixed << setprecision(1);
+    for (const BenchResult &result: results){
+        auto old = find_if(baseline.begin(), baseline.end(), [&](const BenchResult &b){ return b.name == result.name; });
+        out << result.name << string(30 - result.name.size(), ' ');
+        if (old == baseline.end()){
+            out << "not in the baseline\n";
+            continue;
+        }
+        double change = (result.mean - old->mean) / old->mean * 100;
+        double noise = 2 * sqrt(result.variance + (isnan(old->variance) ? 0 : old->variance));
+        bool significant = abs(change) > threshold && abs(result.mean - old->mean) > noise;
+        out << setw(10) << old->mean << " -> " << setw(10) << result.mean << " ns/op  "
+            << showpos << change << noshowpos << "%"
+            << (significant ? (change > 0 ? "  SLOWER" : "  faster") : "");
+        if (old->checksum != result.checksum){
+            out << "  RESULTS DIFFER";
+        }
+        out << "\n";
+        regressed = regressed || (significant && change > 0) || old->checksum != result.checksum;
+    }
+    out << flush;
+    return regressed ? 1 : 0;
+}
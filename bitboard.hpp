@@ -0,0 +1,58 @@
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+#include <cstdint>
+
+// 64 bit set where each bit represents one tile of the board
+// tiles are numbered row by row starting from red's back row so that
+// square = x * 8 + y, using the same x(row) and y(column) coordinates as the rest of the game
+typedef uint64_t Bitboard;
+
+// returns the square index of the tile at row x and column y
+constexpr int make_square(int x, int y){
+    return x * 8 + y;
+}
+
+// returns the row(x coordinate) of a square
+constexpr int square_x(int square){
+    return square >> 3;
+}
+
+// returns the column(y coordinate) of a square
+constexpr int square_y(int square){
+    return square & 7;
+}
+
+// returns a bitboard with only the bit of the specified square set
+constexpr Bitboard square_bb(int square){
+    return Bitboard(1) << square;
+}
+
+// returns a bitboard with every square of row x set
+constexpr Bitboard row_bb(int x){
+    return Bitboard(0xFF) << (x * 8);
+}
+
+// returns a bitboard with every square of column y set
+constexpr Bitboard col_bb(int y){
+    return Bitboard(0x0101010101010101) << y;
+}
+
+// returns the number of squares set in a bitboard
+inline int pop_count(Bitboard bb){
+    return __builtin_popcountll(bb);
+}
+
+// returns the lowest square set in a non empty bitboard
+inline int lsb(Bitboard bb){
+    return __builtin_ctzll(bb);
+}
+
+// returns the lowest square set in a non empty bitboard and clears it
+// used to loop over every square of a bitboard
+inline int pop_lsb(Bitboard &bb){
+    int square = lsb(bb);
+    bb &= bb - 1;
+    return square;
+}
+
+#endif
@@ -1,211 +1,656 @@
 #ifndef BOARD_HPP
 #define BOARD_HPP
 
-#include <vector>
+#include <cctype>
+#include <cstdint>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "bitboard.hpp"
+#include "attacks.hpp"
+#include "move.hpp"
+#include "zobrist.hpp"
+#include "pst.hpp"
+#include "instrument.hpp"
 
 enum TileOwner{white, red, nobody};
+enum PieceType{pawn, knight, bishop, rook, queen, king, noPiece};
 
-// class that represents a single tile on the chess board
-class Tile{
-    TileOwner owner;
-    char symbol;
+// symbol used to display each piece type, indexed by PieceType
+const char PIECE_SYMBOLS[] = "PNBRQK*";
 
-    public:
-    Tile()
-        : owner{nobody}, symbol{'*'}{}
-    
-    // changes the "owner" of a tile to white red or nobody
-    // primarily used to update which team is occupying a tile when a piece is moved
-    // if tile is vacant team can be "nobody"
-    void change_owner(const TileOwner newOwner, char newSymbol){
-        owner = newOwner;
-        symbol = newSymbol;
+// returns the piece type represented by a symbol
+// accepts lower case symbols as they are valid user input for pawn upgrades
+inline PieceType symbol_to_type(char symbol){
+    switch (symbol){
+        case 'P': case 'p': return pawn;
+        case 'N': case 'n': return knight;
+        case 'B': case 'b': return bishop;
+        case 'R': case 'r': return rook;
+        case 'Q': case 'q': return queen;
+        case 'K': case 'k': return king;
+        default: return noPiece;
     }
+}
+
+// castling rights of a position stored as one bit per team and side of the board
+enum CastlingRight{whiteKingside = 1, whiteQueenside = 2, redKingside = 4, redQueenside = 8, allCastling = 15};
+
+// square index used when a position has no en passant square
+const int NO_SQUARE = 64;
+
+// most moves that can be made on a board without being unmade
+const int MAX_UNDO = 1024;
+
+// state a move destroys that is needed to undo it
+struct UndoRecord{
+    // tile code of the piece captured by the move
+    uint8_t captured;
+    uint8_t castling;
+    uint8_t epSquare;
+    uint16_t halfmoveClock;
+    uint64_t key;
+};
+
+
+// class that represents state of chess board
+// pieces are stored as bitboards, one per piece type and one per team, plus a mask
+// of every occupied tile so that whole board questions are answered with a few bit operations
+// a square indexed copy of the piece on each tile is kept alongside so that single tile
+// lookups are one load instead of a scan of the bitboards
+class alignas(64) Board{
+    // tiles holding a piece of each type regardless of team
+    Bitboard typeBB[6];
+    // tiles holding a piece of each team
+    Bitboard ownerBB[2];
+    // tiles holding any piece
+    Bitboard occupied;
+    // piece on each tile with the type in the low 3 bits and owner in the bits above
+    uint8_t tiles[64];
+    // team whose turn it is to move
+    TileOwner turn;
+    // CastlingRight bits still available to each team
+    uint8_t castling;
+    // square a pawn can move to when taking en passant or NO_SQUARE
+    // only set when a pawn of the team to move is actually next to the pawn that moved 2 spaces
+    uint8_t epSquare;
+    // zobrist hash key of the position, kept up to date as pieces are placed and removed
+    uint64_t key;
+    // sums of the midgame and endgame piece-square scores of every piece and the game phase,
+    // kept up to date as pieces are placed and removed so the evaluation is a few operations
+    int midgame;
+    int endgame;
+    int phase;
+    // moves since the last capture or pawn move, used by the fifty move rule
+    uint16_t halfmoveClock;
+    uint16_t fullmoveNumber;
+    // records of the moves made with make_move that have not been unmade yet
+    // kept after the position so the position itself stays within the first cache lines
+    int undoCount;
+    UndoRecord undoStack[MAX_UNDO];
 
-    // returns the current owner or team occupying tile
-    TileOwner return_owner() const{
-        return owner;
+    static constexpr uint8_t EMPTY_TILE = noPiece | (nobody << 3);
+
+    // returns the next free record of the undo stack
+    // throws std::length_error once MAX_UNDO moves are made without being unmade instead of writing past it
+    UndoRecord &push_undo(){
+        if (undoCount == MAX_UNDO){
+            throw std::length_error("more than " + std::to_string(MAX_UNDO) + " moves made without being unmade");
+        }
+        return undoStack[undoCount++];
     }
 
-    // changes the symbol that the tile is represented by
-    // used to update the board when pieces are moved
-    void change_symbol(char newSymbol){
-        symbol = newSymbol;
+    // returns the castling rights kept when a piece moves from or to a square
+    // moving a king or rook, or capturing a rook, removes the rights that piece is part of
+    static uint8_t castling_kept(int square){
+        switch (square){
+            case make_square(0, 0): return allCastling & ~redQueenside;
+            case make_square(0, 4): return allCastling & ~(redKingside | redQueenside);
+            case make_square(0, 7): return allCastling & ~redKingside;
+            case make_square(7, 0): return allCastling & ~whiteQueenside;
+            case make_square(7, 4): return allCastling & ~(whiteKingside | whiteQueenside);
+            case make_square(7, 7): return allCastling & ~whiteKingside;
+            default: return allCastling;
+        }
     }
 
-    // return the symbol of the tile
-    // used to check if a piece is occupying a tile
-    char return_symbol() const{
-        return symbol;
+    // sets the en passant square behind a pawn that just moved 2 spaces
+    // if a pawn of the team to move can take it, leaving it unset otherwise so that positions
+    // that only differ by an en passant square no one can use hash the same
+    void set_en_passant(int square){
+        if (pawn_attacks(turn ^ 1, square) & pieces(turn, pawn)){
+            epSquare = square;
+            key ^= ZOBRIST.epColumn[square_y(square)];
+        }
     }
-};
 
+    // sets up the position of a FEN string over whatever was on the board, see set_fen
+    void load_fen(const std::string &fen){
+        clear();
+        std::istringstream fields(fen);
+        std::string placement, side, rights, ep;
+        fields >> placement >> side >> rights >> ep;
+        int x = 0;
+        int y = 0;
+        for (char c: placement){
+            // every rank has to add up to exactly 8 squares
+            if (c == '/' && y == 8){
+                x++;
+                y = 0;
+            } else if (c >= '1' && c <= '8' && y + (c - '0') <= 8){
+                y += c - '0';
+            } else if (symbol_to_type(c) != noPiece && x < 8 && y < 8){
+                put_piece(isupper(c) ? white : red, symbol_to_type(c), make_square(x, y));
+                y++;
+            } else {
+                throw std::invalid_argument("invalid FEN piece placement: " + fen);
+            }
+        }
+        if (x != 7 || y != 8 || pop_count(pieces(white, king)) != 1 || pop_count(pieces(red, king)) != 1
+            || (pieces(pawn) & (row_bb(0) | row_bb(7)))){
+            throw std::invalid_argument("invalid FEN piece placement: " + fen);
+        }
+        if (side != "w" && side != "b"){
+            throw std::invalid_argument("invalid FEN side to move: " + fen);
+        }
+        turn = side == "b" ? red : white;
+        // the team that just moved can't have left its king in check
+        if (square_attacked(king_square(TileOwner(turn ^ 1)), turn)){
+            throw std::invalid_argument("FEN position with the team not to move in check: " + fen);
+        }
+        for (char c: rights){
+            if (c == 'K'){
+                castling |= whiteKingside;
+            } else if (c == 'Q'){
+                castling |= whiteQueenside;
+            } else if (c == 'k'){
+                castling |= redKingside;
+            } else if (c == 'q'){
+                castling |= redQueenside;
+            }
+        }
+        const int rightSquares[4][2] = {{make_square(7, 4), make_square(7, 7)}, {make_square(7, 4), make_square(7, 0)},
+                                        {make_square(0, 4), make_square(0, 7)}, {make_square(0, 4), make_square(0, 0)}};
+        for (int right = 0; right < 4; right++){
+            TileOwner owner = right < 2 ? white : red;
+            if (tiles[rightSquares[right][0]] != (king | owner << 3) || tiles[rightSquares[right][1]] != (rook | owner << 3)){
+                castling &= ~(1 << right);
+            }
+        }
+        // the square a pawn skipped is behind it, on the 6th rank when white moves next and the 3rd when red does
+        if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] == (turn == white ? '6' : '3')){
+            set_en_passant(make_square('8' - ep[1], ep[0] - 'a'));
+        } else if (!ep.empty() && ep != "-"){
+            throw std::invalid_argument("invalid FEN en passant square: " + fen);
+        }
+        if (!(fields >> halfmoveClock >> fullmoveNumber)){
+            halfmoveClock = 0;
+            fullmoveNumber = 1;
+        }
+        key = compute_key();
+    }
 
-// class that represents visual state of chess board
-class Board{
-    // 2d board
-    std::vector<std::vector<Tile>> board;
     public:
     // initializes chess board to default state
-    Board()
-        : board{std::vector<std::vector<Tile>>(8, std::vector<Tile>(8))}{
-            board[0][0].change_owner(red, 'R');
-            board[0][1].change_owner(red, 'N');
-            board[0][2].change_owner(red, 'B');
-            board[0][3].change_owner(red, 'Q');
-            board[0][4].change_owner(red, 'K');
-            board[0][5].change_owner(red, 'B');
-            board[0][6].change_owner(red, 'N');
-            board[0][7].change_owner(red, 'R');
-
-            for (size_t i = 0; i < 8; i++){
-                board[1][i].change_owner(red, 'P');
-            }
+    Board(){
+        clear();
+        const PieceType backRow[8] = {rook, knight, bishop, queen, king, bishop, knight, rook};
+        for (int col = 0; col < 8; col++){
+            put_piece(red, backRow[col], make_square(0, col));
+            put_piece(red, pawn, make_square(1, col));
+            put_piece(white, pawn, make_square(6, col));
+            put_piece(white, backRow[col], make_square(7, col));
+        }
+        castling = allCastling;
+        key = compute_key();
+    }
+
+    // initializes chess board to the position described by a FEN string
+    // red takes the place of black so lower case FEN pieces are red
+    explicit Board(const std::string &fen){
+        load_fen(fen);
+    }
+
+    // sets up the position described by a FEN string
+    // throws std::invalid_argument, leaving the board as it was, if the piece placement can't be read,
+    // doesn't give each team one king or has a pawn on a back row, the side to move isn't w or b,
+    // the team not to move is in check or the en passant square isn't on the rank a pawn moving 2 spaces skips
+    // castling rights whose king or rook isn't on its starting square are dropped
+    void set_fen(const std::string &fen){
+        // built aside so a rejected FEN doesn't leave this board half set up
+        Board parsed;
+        parsed.load_fen(fen);
+        *this = parsed;
+    }
 
-            for (size_t i = 0; i < 8; i++){
-                board[6][i].change_owner(white, 'P');
+    // returns the FEN string of the position, with red written as black
+    std::string fen() const{
+        std::string fen;
+        for (int x = 0; x < 8; x++){
+            int empty = 0;
+            for (int y = 0; y < 8; y++){
+                int square = make_square(x, y);
+                if (owner_at(square) == nobody){
+                    empty++;
+                    continue;
+                }
+                if (empty > 0){
+                    fen += char('0' + empty);
+                    empty = 0;
+                }
+                char symbol = PIECE_SYMBOLS[type_at(square)];
+                fen += owner_at(square) == white ? symbol : char(tolower(symbol));
+            }
+            if (empty > 0){
+                fen += char('0' + empty);
+            }
+            if (x < 7){
+                fen += '/';
             }
+        }
+        fen += turn == white ? " w " : " b ";
+        std::string rights;
+        const char rightSymbols[] = "KQkq";
+        for (int right = 0; right < 4; right++){
+            if (castling & (1 << right)){
+                rights += rightSymbols[right];
+            }
+        }
+        fen += rights.empty() ? "-" : rights;
+        fen += " " + (epSquare == NO_SQUARE ? std::string("-") : square_name(epSquare));
+        fen += " " + std::to_string(halfmoveClock) + " " + std::to_string(fullmoveNumber);
+        return fen;
+    }
 
-            board[7][0].change_owner(white, 'R');
-            board[7][1].change_owner(white, 'N');
-            board[7][2].change_owner(white, 'B');
-            board[7][3].change_owner(white, 'Q');
-            board[7][4].change_owner(white, 'K');
-            board[7][5].change_owner(white, 'B');
-            board[7][6].change_owner(white, 'N');
-            board[7][7].change_owner(white, 'R');
+    // removes every piece from the board
+    void clear(){
+        for (auto &bb: typeBB){
+            bb = 0;
+        }
+        ownerBB[white] = ownerBB[red] = 0;
+        occupied = 0;
+        for (auto &tile: tiles){
+            tile = EMPTY_TILE;
         }
+        turn = white;
+        castling = 0;
+        epSquare = NO_SQUARE;
+        halfmoveClock = 0;
+        fullmoveNumber = 1;
+        key = 0;
+        midgame = endgame = phase = 0;
+        undoCount = 0;
+    }
+
+    // places a piece on a vacant square
+    void put_piece(TileOwner owner, PieceType type, int square){
+        Bitboard bb = square_bb(square);
+        typeBB[type] |= bb;
+        ownerBB[owner] |= bb;
+        occupied |= bb;
+        tiles[square] = type | (owner << 3);
+        key ^= ZOBRIST.pieces[owner][type][square];
+        midgame += PIECE_SQUARE_SCORES.midgame[owner][type][square];
+        endgame += PIECE_SQUARE_SCORES.endgame[owner][type][square];
+        phase += PHASE_WEIGHTS[type];
+    }
+
+    // removes the piece occupying a square
+    void remove_piece(int square){
+        key ^= ZOBRIST.pieces[owner_at(square)][type_at(square)][square];
+        midgame -= PIECE_SQUARE_SCORES.midgame[owner_at(square)][type_at(square)][square];
+        endgame -= PIECE_SQUARE_SCORES.endgame[owner_at(square)][type_at(square)][square];
+        phase -= PHASE_WEIGHTS[type_at(square)];
+        Bitboard bb = square_bb(square);
+        typeBB[type_at(square)] &= ~bb;
+        ownerBB[owner_at(square)] &= ~bb;
+        occupied &= ~bb;
+        tiles[square] = EMPTY_TILE;
+    }
 
     // update board after moving piece
-    void update_board(int newX, int newY, int oldX, int oldY, char pieceType){
-        TileOwner owner = board[oldX][oldY].return_owner();
-        board[oldX][oldY].change_owner(nobody, '*');
-        board[newX][newY].change_owner(owner, pieceType);
+    void update_board(int newX, int newY, int oldX, int oldY){
+        play_move(move_between(make_square(oldX, oldY), make_square(newX, newY)));
     }
 
     // change tile symbol on board at specified position
+    // the tile keeps its owner, a symbol of '*' vacates the tile
     void change_tile_symbol(char symbol, int x, int y){
-        board[x][y].change_symbol(symbol);
+        int square = make_square(x, y);
+        TileOwner owner = owner_at(square);
+        remove_piece(square);
+        if (symbol != '*'){
+            put_piece(owner, symbol_to_type(symbol), square);
+        }
     }
 
     // return tile symbol on board at specified position
     char return_symbol(int x, int y) const{
-        return board[x][y].return_symbol();
+        return PIECE_SYMBOLS[type_at(make_square(x, y))];
     }
     
     // return player occupying tile on board or if it is vacant
     TileOwner return_owner(int x, int y) const{
-        return board[x][y].return_owner();
+        return owner_at(make_square(x, y));
+    }
+
+    // return type of piece on a square or noPiece if it is vacant
+    PieceType type_at(int square) const{
+        return PieceType(tiles[square] & 7);
+    }
+
+    // return player occupying a square or nobody if it is vacant
+    TileOwner owner_at(int square) const{
+        return TileOwner(tiles[square] >> 3);
+    }
+
+    // return tiles holding pieces of a type for both teams
+    Bitboard pieces(PieceType type) const{
+        return typeBB[type];
+    }
+
+    // return tiles holding any of a team's pieces
+    Bitboard pieces(TileOwner owner) const{
+        return ownerBB[owner];
+    }
+
+    // return tiles holding a team's pieces of a type
+    Bitboard pieces(TileOwner owner, PieceType type) const{
+        return ownerBB[owner] & typeBB[type];
+    }
+
+    // return every occupied tile
+    Bitboard occupancy() const{
+        return occupied;
+    }
+
+    // return team whose turn it is to move
+    TileOwner side_to_move() const{
+        return turn;
+    }
+
+    // sets the team to move, for positions set up piece by piece after clear
+    void set_side_to_move(TileOwner team){
+        if (team != turn){
+            turn = team;
+            key ^= ZOBRIST.redToMove;
+        }
+    }
+
+    // return CastlingRight bits still available
+    int castling_rights() const{
+        return castling;
+    }
+
+    // return square a pawn can move to when taking en passant or NO_SQUARE
+    int en_passant_square() const{
+        return epSquare;
+    }
+
+    // return square of a team's king
+    int king_square(TileOwner owner) const{
+        return lsb(pieces(owner, king));
+    }
+
+    // return if any piece of a team attacks a square
+    bool square_attacked(int square, TileOwner by) const{
+        Bitboard attackers = ownerBB[by];
+        Bitboard diagonal = typeBB[bishop] | typeBB[queen];
+        Bitboard straight = typeBB[rook] | typeBB[queen];
+        // a pawn of team "by" attacks the square if a pawn of the other team on the square would attack it
+        return (pawn_attacks(by ^ 1, square) & typeBB[pawn] & attackers)
+            || (knight_attacks(square) & typeBB[knight] & attackers)
+            || (king_attacks(square) & typeBB[king] & attackers)
+            || (bishop_attacks(square, occupied) & diagonal & attackers)
+            || (rook_attacks(square, occupied) & straight & attackers);
+    }
+
+    // return if the team to move is under check
+    bool in_check() const{
+        return square_attacked(king_square(turn), TileOwner(turn ^ 1));
+    }
+
+    // returns the move of the piece on one square to another with its flags worked out from the board
+    // a king moving two columns castles and a pawn moving diagonally to a vacant square takes en passant
+    // pawns reaching the last row are promoted to the specified piece type if one is given
+    Move move_between(int from, int to, PieceType promotion = noPiece) const{
+        PieceType type = type_at(from);
+        int flags = owner_at(to) != nobody ? captureMove : quietMove;
+        int columns = square_y(to) - square_y(from);
+        if (type == king && (columns == 2 || columns == -2)){
+            flags = columns > 0 ? kingCastle : queenCastle;
+        } else if (type == pawn){
+            if (to - from == 16 || from - to == 16){
+                flags = doublePawnPush;
+            } else if (columns != 0 && flags == quietMove){
+                flags = enPassant;
+            } else if (promotion != noPiece && (square_x(to) == 0 || square_x(to) == 7)){
+                flags |= knightPromotion | (promotion - knight);
+            }
+        }
+        return encode_move(from, to, flags);
+    }
+
+    // plays a move that will not be unmade, updating castling rights, the en passant square,
+    // move clocks and whose turn it is
+    // move is expected to be pseudo legal in the current position
+    void play_move(Move move){
+        int from = move_from(move);
+        int to = move_to(move);
+        int flags = move_flags(move);
+        TileOwner us = owner_at(from);
+        PieceType type = type_at(from);
+
+        halfmoveClock++;
+        if (type == pawn || is_capture(move)){
+            halfmoveClock = 0;
+        }
+        if (flags == enPassant){
+            // captured pawn sits behind the square moved to
+            remove_piece(us == white ? to + 8 : to - 8);
+        } else if (is_capture(move)){
+            remove_piece(to);
+        }
+        remove_piece(from);
+        put_piece(us, is_promotion(move) ? PieceType(promotion_type(move)) : type, to);
+        if (flags == kingCastle){
+            remove_piece(to + 1);
+            put_piece(us, rook, to - 1);
+        } else if (flags == queenCastle){
+            remove_piece(to - 2);
+            put_piece(us, rook, to + 1);
+        }
+
+        turn = TileOwner(us ^ 1);
+        key ^= ZOBRIST.redToMove;
+        if (epSquare != NO_SQUARE){
+            key ^= ZOBRIST.epColumn[square_y(epSquare)];
+            epSquare = NO_SQUARE;
+        }
+        if (flags == doublePawnPush){
+            set_en_passant((from + to) / 2);
+        }
+        key ^= ZOBRIST.castling[castling];
+        castling &= castling_kept(from) & castling_kept(to);
+        key ^= ZOBRIST.castling[castling];
+        if (us == red){
+            fullmoveNumber++;
+        }
+#ifdef VERIFY_HASH
+        verify_key();
+        verify_scores();
+#endif
+    }
+
+    // plays a move that can later be taken back with unmake_move
+    // pushes the captured piece and the castling, en passant and clock state onto the undo stack
+    // throws std::length_error if the undo stack is full
+    void make_move(Move move){
+        int captureSquare = move_to(move);
+        if (move_flags(move) == enPassant){
+            captureSquare += owner_at(move_from(move)) == white ? 8 : -8;
+        }
+        UndoRecord &undo = push_undo();
+        undo.captured = tiles[captureSquare];
+        undo.castling = castling;
+        undo.epSquare = epSquare;
+        undo.halfmoveClock = halfmoveClock;
+        undo.key = key;
+        play_move(move);
+    }
+
+    // takes back the last move played with make_move
+    void unmake_move(Move move){
+        const UndoRecord &undo = undoStack[--undoCount];
+        int from = move_from(move);
+        int to = move_to(move);
+        int flags = move_flags(move);
+        TileOwner us = owner_at(to);
+
+        if (flags == kingCastle){
+            remove_piece(to - 1);
+            put_piece(us, rook, to + 1);
+        } else if (flags == queenCastle){
+            remove_piece(to + 1);
+            put_piece(us, rook, to - 2);
+        }
+        PieceType type = is_promotion(move) ? pawn : type_at(to);
+        remove_piece(to);
+        put_piece(us, type, from);
+        if (undo.captured != EMPTY_TILE){
+            int captureSquare = flags == enPassant ? (us == white ? to + 8 : to - 8) : to;
+            put_piece(TileOwner(undo.captured >> 3), PieceType(undo.captured & 7), captureSquare);
+        }
+
+        castling = undo.castling;
+        epSquare = undo.epSquare;
+        halfmoveClock = undo.halfmoveClock;
+        key = undo.key;
+        if (us == red){
+            fullmoveNumber--;
+        }
+        turn = us;
+#ifdef VERIFY_HASH
+        verify_key();
+        verify_scores();
+#endif
+    }
+
+    // passes the turn to the other team without moving a piece
+    // used by the search to see if a position is still good after giving the opponent a free move
+    void make_null_move(){
+        UndoRecord &undo = push_undo();
+        undo.captured = EMPTY_TILE;
+        undo.castling = castling;
+        undo.epSquare = epSquare;
+        undo.halfmoveClock = halfmoveClock;
+        undo.key = key;
+        if (epSquare != NO_SQUARE){
+            key ^= ZOBRIST.epColumn[square_y(epSquare)];
+            epSquare = NO_SQUARE;
+        }
+        halfmoveClock++;
+        turn = TileOwner(turn ^ 1);
+        key ^= ZOBRIST.redToMove;
+    }
+
+    // takes back the last null move
+    void unmake_null_move(){
+        const UndoRecord &undo = undoStack[--undoCount];
+        epSquare = undo.epSquare;
+        halfmoveClock = undo.halfmoveClock;
+        key = undo.key;
+        turn = TileOwner(turn ^ 1);
+    }
+
+    // return moves since the last capture or pawn move
+    int halfmove_clock() const{
+        return halfmoveClock;
+    }
+
+    // return zobrist hash key of the position
+    uint64_t hash_key() const{
+        return key;
+    }
+
+    // computes the hash key of the position from scratch
+    // the key kept by the board is only ever updated incrementally, this is used to set it up
+    // and to check the incremental updates
+    uint64_t compute_key() const{
+        uint64_t fullKey = ZOBRIST.castling[castling];
+        Bitboard bb = occupied;
+        while (bb){
+            int square = pop_lsb(bb);
+            fullKey ^= ZOBRIST.pieces[owner_at(square)][type_at(square)][square];
+        }
+        if (turn == red){
+            fullKey ^= ZOBRIST.redToMove;
+        }
+        if (epSquare != NO_SQUARE){
+            fullKey ^= ZOBRIST.epColumn[square_y(epSquare)];
+        }
+        return fullKey;
+    }
+
+    // throws std::logic_error if the incrementally updated key differs from a full recompute
+    // called after every move when compiled with VERIFY_HASH defined
+    void verify_key() const{
+        if (key != compute_key()){
+            throw std::logic_error("incremental hash key does not match recomputed key");
+        }
     }
     
+    // return the midgame piece-square score of the position, positive when white is ahead
+    int midgame_score() const{
+        return midgame;
+    }
+
+    // return the endgame piece-square score of the position, positive when white is ahead
+    int endgame_score() const{
+        return endgame;
+    }
+
+    // return the game phase, the weighted count of pieces left, see PHASE_WEIGHTS
+    int game_phase() const{
+        return phase;
+    }
+
+    // throws std::logic_error if the incrementally updated scores or phase differ from a full recompute
+    // called after every move when compiled with VERIFY_HASH defined
+    void verify_scores() const{
+        int fullMidgame = 0;
+        int fullEndgame = 0;
+        int fullPhase = 0;
+        for (int square = 0; square < 64; square++){
+            if (owner_at(square) != nobody){
+                fullMidgame += PIECE_SQUARE_SCORES.midgame[owner_at(square)][type_at(square)][square];
+                fullEndgame += PIECE_SQUARE_SCORES.endgame[owner_at(square)][type_at(square)][square];
+                fullPhase += PHASE_WEIGHTS[type_at(square)];
+            }
+        }
+        if (midgame != fullMidgame || endgame != fullEndgame || phase != fullPhase){
+            throw std::logic_error("incremental evaluation scores do not match recomputed scores");
+        }
+    }
+
+    // return if every square strictly between two squares on the same row, column or diagonal is vacant
+    bool path_clear(int from, int to) const{
+        return !(occupied & between_bb(from, to));
+    }
+
     // return if there is a piece within a straight line region formed by 
     // the current and desired position to move to
-    // created to speed up checking if a piece is in a straight region
-    // as its quicker than looping through piece set for every piece in region
-    // as this has a maximum of 8 checks(8x8 board) compared to 128(16*8)
     bool piece_blocking_straight_move(int x, int y, int currX, int currY) const{
-        int xDiff = x - currX;
-        int yDiff = y - currY;
-        
-        // 4 control statments for if region from currX to desired x is moving forward,
-        // backward, left, or right
-        if (xDiff > 0){
-            currX++;
-            while (currX != x){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currX++;
-            }
-            return false;
-        } else if (xDiff < 0){
-            currX--;
-            while (currX != x){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currX--;
-            }
-            return false;
-        } else if (yDiff > 0){
-            currY++;
-            while (currY != y){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currY++;
-            }
-            return false;
-        } else{
-            currY--;
-            while (currY != y){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currY--;
-            }
-            return false;
-        }
+        COUNT_CALL(rayScans);
+        return !path_clear(make_square(currX, currY), make_square(x, y));
     }
 
     // return if there is a piece within a diagnol region formed by 
     // the current and desired position to move to
-    // created to speed up checking if a piece is in a diagnol region
-    // as its quicker than looping through piece set for every piece in region
-    // as this has a maximum of 8 checks(8x8 board) compared to 128(16*8)
     bool piece_blocking_diagnol_move(int x, int y, int currX, int currY) const{
-        int xDiff = x - currX;
-        int yDiff = y - currY;
-
-        // 4 control statments for if region from currX to desired x is moving forward right,
-        // forward left, backward right, or  backward left
-        if (xDiff < 0 && yDiff < 0){
-            currX--;
-            currY--;
-            while (currX != x){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currX--;
-                currY--;
-            }
-            return false;
-        } else if (xDiff < 0 && yDiff > 0){
-            currX--;
-            currY++;
-            while (currX != x){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currX--;
-                currY++;
-            }
-            return false;
-        } else if (xDiff > 0 && yDiff < 0){
-            currX++;
-            currY--;
-            while (currX != x){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currX++;
-                currY--;
-            }
-            return false;
-        } else{
-            currX++;
-            currY++;
-            while (currX != x){
-                if (board[currX][currY].return_symbol() != '*'){
-                    return true;
-                }
-                currX++;
-                currY++;
-            }
-            return false;
-        }
-
+        COUNT_CALL(rayScans);
+        return !path_clear(make_square(currX, currY), make_square(x, y));
     }
 
     // prints the board to terminal
@@ -213,17 +658,17 @@ class Board{
         const std::string RED_TEXT = "\033[31m";
         const std::string RESET_COLOR = "\033[0m";
         std::cout << "   ";
-        for (size_t col = 0; col < board[0].size(); col++){
+        for (int col = 0; col < 8; col++){
             std::cout << col << " ";
         }
         std::cout << "\n";
-        for (size_t row = 0; row < board.size(); row++){
+        for (int row = 0; row < 8; row++){
             std::cout << row << "  ";
-            for (size_t col = 0; col < board[0].size(); col++){
-                if(board[row][col].return_owner() == red){
-                    std::cout << RED_TEXT << board[row][col].return_symbol() << " " << RESET_COLOR;
+            for (int col = 0; col < 8; col++){
+                if(return_owner(row, col) == red){
+                    std::cout << RED_TEXT << return_symbol(row, col) << " " << RESET_COLOR;
                 } else {
-                    std::cout << board[row][col].return_symbol() << " ";
+                    std::cout << return_symbol(row, col) << " ";
                 } 
             }
             std::cout << "\n";
@@ -0,0 +1,107 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "game_record.hpp"
+#include "opening_book.hpp"
+#include "pgn.hpp"
+using namespace std;
+
+// the key test positions of the Polyglot book format: the moves played from the start position
+// and the Polyglot key of the position they lead to
+struct KeyCase{
+    const char *moves;
+    uint64_t key;
+};
+
+const KeyCase KEY_CASES[] = {
+    {"", 0x463B96181691FC9C},
+    {"e2e4", 0x823C9B50FD114196},
+    {"e2e4 d7d5", 0x0756B94461C50FB0},
+    {"e2e4 d7d5 e4e5", 0x662FAFB965DB29D4},
+    {"e2e4 d7d5 e4e5 f7f5", 0x22A48B5A8E47FF78},
+    {"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652A607CA3F242C1},
+    {"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00FDD303C946BDD9},
+    {"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3C8123EA7B067637},
+    {"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5C3F9B829B279560},
+};
+
+// plays each test position's moves and compares its key, returns 1 if any differs
+int run_checks(){
+    int failures = 0;
+    for (const KeyCase &check: KEY_CASES){
+        Board board;
+        istringstream moves(check.moves);
+        string text;
+        while (moves >> text){
+            MoveList legal;
+            generate_legal_moves(board, legal);
+            for (Move move: legal){
+                if (move_to_string(move) == text){
+                    board.play_move(move);
+                    break;
+                }
+            }
+        }
+        if (book_key(board) != check.key){
+            cout << "FAILED \"" << check.moves << "\": " << hex << book_key(board) << " instead of "
+                 << check.key << dec << "\n";
+            failures++;
+        }
+    }
+    size_t count = sizeof(KEY_CASES) / sizeof(KEY_CASES[0]);
+    cout << count - failures << "/" << count << " Polyglot key checks passed" << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// usage: book_build <games.cgr> <book.bin> [--plies N] [--min W]
+//        book_build --check
+// builds an opening book from the first N plies(default 20) of every game of a record file
+// a move scores 2 when its team went on to win, 1 in drawn or unfinished games and nothing when it lost,
+// moves scoring less than W(default 1) in total are left out
+// --check compares the keys of the Polyglot format's test positions instead
+int main(int argc, char *argv[]){
+    if (argc == 2 && strcmp(argv[1], "--check") == 0){
+        return run_checks();
+    }
+    if (argc < 3){
+        cerr << "usage: book_build <games.cgr> <book.bin> [--plies N] [--min W]" << endl;
+        return 1;
+    }
+    int maxPlies = 20;
+    uint32_t minimumWeight = 1;
+    for (int i = 3; i < argc; i++){
+        if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc){
+            maxPlies = stoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc){
+            minimumWeight = stoul(argv[++i]);
+        }
+    }
+    try{
+        GameRecordReader reader(argv[1]);
+        BookWriter writer;
+        Board board;
+        for (uint64_t i = 0; i < reader.game_count(); i++){
+            RecordedGame game = reader.game(i);
+            board.set_fen(game.standard_start() ? START_FEN : game.start_fen());
+            int plies = min(game.ply_count(), maxPlies);
+            for (int ply = 0; ply < plies; ply++){
+                Move move = game.move(ply);
+                TileOwner mover = board.side_to_move();
+                RecordResult win = mover == white ? whiteWinResult : redWinResult;
+                RecordResult loss = mover == white ? redWinResult : whiteWinResult;
+                uint32_t weight = game.result() == win ? 2 : (game.result() == loss ? 0 : 1);
+                if (weight > 0){
+                    writer.add(book_key(board), move, weight);
+                }
+                board.play_move(move);
+            }
+        }
+        size_t entries = writer.write(argv[2], minimumWeight);
+        cout << "wrote " << entries << " entries from " << reader.game_count() << " games to " << argv[2] << endl;
+    } catch (const exception &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef ENGINE_PLAYER_HPP
+#define ENGINE_PLAYER_HPP
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "player.hpp"
+#include "search.hpp"
+#include "opening_book.hpp"
+
+// computer player that picks its moves with the search engine
+// searches to a fixed depth or for a fixed time per move, whichever comes first,
+// on as many threads as requested, or plays on a clock with a time control
+// plays from an opening book, if given one, until the game leaves it, and perfectly once
+// few enough pieces are left for the endgame tables given to it
+class EnginePlayer: public Player{
+    Search search;
+    SearchLimits limits;
+    const OpeningBook *book = nullptr;
+    std::mt19937_64 random{std::random_device{}()};
+    // hash keys of every position of the game so far, so the search can see repetitions
+    std::vector<uint64_t> gameKeys;
+    std::string lastMoveInfo;
+    // milliseconds left on the player's clock and added after each move, when playing on a clock
+    bool onClock = false;
+    int64_t clockLeft = 0;
+    int64_t clockIncrement = 0;
+
+    public:
+    EnginePlayer(const std::string &team, const std::string &name, const SearchLimits &limits, int threads = 1)
+        : Player(team, name), search(threads), limits{limits} {}
+
+    // plays the rest of the game on a clock of base milliseconds plus increment milliseconds a move
+    // instead of a fixed time per move, still stopping at the depth limit
+    // the player loses on time, failing to move, once a move takes longer than the clock has left
+    void set_clock(int64_t base, int64_t increment){
+        onClock = true;
+        clockLeft = base;
+        clockIncrement = increment;
+    }
+
+    // returns if the player's clock ran out
+    bool out_of_time() const{
+        return onClock && clockLeft < 0;
+    }
+
+    // sets the size of the player's transposition table in megabytes
+    void set_hash_size(size_t megabytes){
+        search.set_hash_size(megabytes);
+    }
+
+    // sets the opening book to play from, which must outlive the player, or nullptr for none
+    void set_book(const OpeningBook *openingBook){
+        book = openingBook;
+    }
+
+    // sets the endgame tables the search probes, which must outlive the player, or nullptr for none
+    void set_tablebases(const TablebaseSet *tablebases){
+        search.set_tablebases(tablebases);
+    }
+
+    // sets the network the search evaluates positions with, which must outlive the player,
+    // or nullptr for the piece-square evaluation
+    void set_network(const NnueNetwork *network){
+        search.set_network(network);
+    }
+
+    // plays a book move if the position is in the book
+    // otherwise searches the position for the best move and plays it
+    bool move_piece(Board &board, Player &other) override{
+        Move bookMove = book ? book->probe(board, random) : NULL_MOVE;
+        if (bookMove != NULL_MOVE){
+            gameKeys.push_back(board.hash_key());
+            apply_move(board, other, bookMove);
+            gameKeys.push_back(board.hash_key());
+            lastMoveInfo = return_name() + " played " + move_to_string(bookMove) + " from the opening book\n";
+            return true;
+        }
+        SearchLimits moveLimits = limits;
+        if (onClock){
+            // spend an even share of the clock over the moves left, keeping a margin for overhead
+            int64_t share = clockLeft / 30 + clockIncrement * 3 / 4;
+            moveLimits.moveTime = std::max<int64_t>(1, std::min(share, clockLeft - 50));
+        }
+        auto start = std::chrono::steady_clock::now();
+        search.prepare();
+        SearchResult result = search.think(board, moveLimits, gameKeys);
+        if (onClock){
+            clockLeft -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            if (clockLeft < 0){
+                lastMoveInfo = return_name() + " lost on time";
+                return false;
+            }
+            clockLeft += clockIncrement;
+        }
+        if (result.bestMove == NULL_MOVE){
+            lastMoveInfo = return_name() + " has no legal move";
+            return false;
+        }
+        gameKeys.push_back(board.hash_key());
+        apply_move(board, other, result.bestMove);
+        gameKeys.push_back(board.hash_key());
+
+        std::ostringstream info;
+        info << return_name() << " played " << move_to_string(result.bestMove)
+             << "  depth " << result.depth << "  nodes " << result.nodes
+             << "  nps " << uint64_t(result.nodes / std::max(result.seconds, 1e-9))
+             << "  score " << score_to_string(result.score) << "\n";
+        lastMoveInfo = info.str();
+        return true;
+    }
+
+    std::string return_last_move_info() const override{
+        return lastMoveInfo;
+    }
+};
+
+#endif
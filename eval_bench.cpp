@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "search.hpp"
+using namespace std;
+
+// replays every game, calling evaluation on each position along the way, and returns the seconds taken
+// the scores are summed into a checksum so the compiler can't drop the calls
+template <typename Evaluation>
+double replay(Board &board, const vector<vector<Move>> &games, int64_t &checksum, Evaluation evaluation){
+    checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (const vector<Move> &game: games){
+        board = Board();
+        for (Move move: game){
+            board.play_move(move);
+            checksum += evaluation(board);
+        }
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// usage: eval_bench [games]
+// plays N(default 2000) random games and compares the evaluation kept up to date by the board's moves
+// against adding up every piece of each position from scratch
+// the time of replaying the games alone is taken off both so only the evaluation calls are compared
+int main(int argc, char *argv[]){
+    int gameCount = argc > 1 ? stoi(argv[1]) : 2000;
+    mt19937_64 random(2024);
+    unique_ptr<Board> board(new Board());
+    vector<vector<Move>> games(gameCount);
+    size_t positions = 0;
+    for (vector<Move> &game: games){
+        *board = Board();
+        for (int ply = 0; ply < 200; ply++){
+            MoveList moves;
+            generate_legal_moves(*board, moves);
+            if (moves.size() == 0){
+                break;
+            }
+            Move move = moves[random() % moves.size()];
+            board->play_move(move);
+            game.push_back(move);
+        }
+        positions += game.size();
+    }
+
+    // every position's two scores must agree before their speeds are worth comparing
+    size_t mismatches = 0;
+    for (const vector<Move> &game: games){
+        *board = Board();
+        for (Move move: game){
+            board->play_move(move);
+            mismatches += evaluate(*board) != evaluate_from_scratch(*board);
+        }
+    }
+
+    int64_t replayed, incremental, scratch;
+    double replaySeconds = replay(*board, games, replayed, [](const Board &){ return 0; });
+    double incrementalSeconds = replay(*board, games, incremental, [](const Board &b){ return evaluate(b); });
+    double scratchSeconds = replay(*board, games, scratch, [](const Board &b){ return evaluate_from_scratch(b); });
+    incrementalSeconds = max(incrementalSeconds - replaySeconds, 1e-9);
+    scratchSeconds = max(scratchSeconds - replaySeconds, 1e-9);
+
+    cout << positions << " positions from " << gameCount << " random games\n"
+         << "replay only      " << replaySeconds * 1e9 / positions << " ns/move\n"
+         << "incremental      " << incrementalSeconds * 1e9 / positions << " ns/eval  "
+         << uint64_t(positions / incrementalSeconds) << " evals/sec\n"
+         << "from scratch     " << scratchSeconds * 1e9 / positions << " ns/eval  "
+         << uint64_t(positions / scratchSeconds) << " evals/sec\n"
+         << "speedup          " << scratchSeconds / incrementalSeconds << "x\n"
+         << (mismatches == 0 && incremental == scratch ? "scores match" : "SCORES DIFFER") << endl;
+    return mismatches == 0 && incremental == scratch ? 0 : 1;
+}
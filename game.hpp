@@ -1,56 +1,310 @@
 #ifndef GAME_HPP
 #define GAME_HPP
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <utility>
+#include <vector>
 #include "player.hpp"
+#include "movegen.hpp"
+#include "game_record.hpp"
 
-// class to create instance of a chess game 
+// how a game ended
+struct GameResult{
+    // "1-0" white won, "0-1" red won, "1/2-1/2" drawn or "*" unfinished
+    std::string score = "*";
+    std::string reason;
+    int plies = 0;
+};
+
+// class to create instance of a chess game
 class Game{
-    Player p1;
-    Player p2;
+    std::unique_ptr<Player> p1;
+    std::unique_ptr<Player> p2;
     Board board;
+    // headless games skip clearing the terminal and printing the board
+    bool display = true;
+    // FEN of the start position, empty for the standard start position
+    std::string startFen;
+    // writer the game is recorded to as it is played, if any
+    GameRecordWriter *recorder = nullptr;
+    // hash keys of every position reached, used to spot threefold repetition
+    std::vector<uint64_t> positions;
+    // player to move and the player who moved last, swapped after every move
+    Player *mover = nullptr;
+    Player *opponent = nullptr;
+    GameResult result;
+    bool over = false;
+    // timing and rules calls of every turn, kept when compiled with INSTRUMENT defined
+    std::vector<TurnStats> turnStats;
+
+    // returns why the game is drawn with the next move still to be played
+    // or an empty string if the game goes on
+    std::string draw_reason(){
+        MoveList moves;
+        generate_legal_moves(board, moves);
+        if (moves.size() == 0 && !board.in_check()){
+            return "STALEMATE!";
+        }
+        if (board.halfmove_clock() >= 100){
+            return "Fifty moves without a capture or pawn move!";
+        }
+        int repetitions = 0;
+        for (uint64_t key: positions){
+            if (key == board.hash_key()){
+                repetitions++;
+            }
+        }
+        if (repetitions >= 3){
+            return "Threefold repetition!";
+        }
+        // lone kings, or a single knight or bishop against a lone king, can't checkmate
+        Bitboard minors = board.pieces(knight) | board.pieces(bishop);
+        if (!(board.pieces(pawn) | board.pieces(rook) | board.pieces(queen)) && pop_count(minors) <= 1){
+            return "Insufficient material!";
+        }
+        return "";
+    }
+
+    // returns if the game is over with toMove to play after lastMover's move, filling in the result
+    bool game_over(Player &lastMover, Player &toMove, GameResult &result){
+        if (toMove.check_mate(lastMover, board)){
+            result.score = &lastMover == p1.get() ? "1-0" : "0-1";
+            result.reason = "checkmate";
+            if (display){
+                std::cout << "CHECKMATE!\n" << lastMover.return_name() << " Wins!" << std::endl;
+            }
+            return true;
+        }
+        std::string draw = draw_reason();
+        if (!draw.empty()){
+            result.score = "1/2-1/2";
+            result.reason = draw;
+            if (display){
+                std::cout << draw << "\nThe game is a draw!" << std::endl;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // ends the game if the player to move is checkmated or the game is drawn
+    bool check_over(){
+        if (game_over(*opponent, *mover, result)){
+            finish();
+        }
+        return over;
+    }
+
+    // marks the game over and records its result
+    void finish(){
+        over = true;
+        if (recorder){
+            recorder->end_game(result_from_score(result.score));
+        }
+    }
 
     public:
     Game(const std::string &whiteName, const std::string &redName)
-        : p1("white", whiteName), p2("red", redName), board() {}
-    
-    // simulates chess game
-    // ends when a player gets checkmated
-    void conduct_game(){
-        bool p1Victorius = false;
-        std::cout << board << "\n";
-        while (true){
-            std::cout << p1.return_name() << "'s turn\n";
-            p1.move_piece(board, p2);
-            system("clear");
+        : p1(new Player("white", whiteName)), p2(new Player("red", redName)), board() {}
+
+    // game between any two players ex. a human and an EnginePlayer
+    Game(std::unique_ptr<Player> white, std::unique_ptr<Player> red)
+        : p1(std::move(white)), p2(std::move(red)), board() {}
+
+    // game between two players starting from the position described by a FEN string
+    // throws std::invalid_argument if the position can't be set up
+    Game(std::unique_ptr<Player> white, std::unique_ptr<Player> red, const std::string &fen)
+        : p1(std::move(white)), p2(std::move(red)), board(fen){
+        p1->set_position(board);
+        p2->set_position(board);
+        if (board.fen() != Board().fen()){
+            startFen = board.fen();
+        }
+    }
+
+    // returns the FEN string of the current position
+    std::string fen() const{
+        return board.fen();
+    }
+
+    // turns the terminal output of the game on or off
+    void set_display(bool on){
+        display = on;
+    }
+
+    // records the moves and result of the game to a writer, which must outlive the game
+    void set_recorder(GameRecordWriter *writer){
+        recorder = writer;
+    }
+
+    // returns the position of the game
+    const Board &return_board() const{
+        return board;
+    }
+
+    // returns the result of the game so far, "*" until it is over
+    const GameResult &return_result() const{
+        return result;
+    }
+
+    bool is_over() const{
+        return over;
+    }
+
+    // sets up the game for its first move
+    // returns false if the game is over before it, ex. a FEN position that is already checkmate
+    bool start(){
+        mover = board.side_to_move() == white ? p1.get() : p2.get();
+        opponent = board.side_to_move() == white ? p2.get() : p1.get();
+        result = GameResult();
+        over = false;
+        turnStats.clear();
+        positions.push_back(board.hash_key());
+        if (display){
             std::cout << board << "\n";
-            Piece *piece = p1.check_pawn_upgrade();
-            if (piece){
-                p1.upgrade_pawn(piece, board);
-                system("clear");
-                std::cout << board << "\n";
-            }
-            if (p2.check_mate(p1, board)){
-                p1Victorius = true;
-                break;
+        }
+        if (recorder){
+            recorder->begin_game(startFen);
+        }
+        return !check_over();
+    }
+
+    // plays the turn of the player to move, then checks if that ended the game
+    // the game also ends when the player has no move to play
+    // returns false once the game is over
+    bool play_turn(){
+        if (over){
+            return false;
+        }
+#ifdef INSTRUMENT
+        TurnStats turn;
+        turn.ply = result.plies + 1;
+        turn.player = mover->return_name();
+        HotPathCounters before = hot_path_counters();
+#endif
+        if (display){
+            TIME_PHASE(turn.renderNanos);
+            std::cout << mover->return_name() << "'s turn\n";
+        }
+        bool moved;
+        {
+            TIME_PHASE(turn.inputNanos);
+            moved = mover->move_piece(board, *opponent);
+        }
+        if (!moved){
+            result.reason = mover->return_last_move_info();
+            if (display){
+                std::cout << result.reason << std::endl;
             }
-            std::cout << p2.return_name() << "'s turn\n";
-            p2.move_piece(board, p1);
+            finish();
+            return false;
+        }
+        result.plies++;
+        if (display){
+            TIME_PHASE(turn.renderNanos);
             system("clear");
-            std::cout << board << "\n";
-            piece = p2.check_pawn_upgrade();
-            if (piece){
-                p2.upgrade_pawn(piece, board);
+            std::cout << board << "\n" << mover->return_last_move_info();
+        }
+        Piece *piece = mover->check_pawn_upgrade();
+        if (piece){
+            TIME_PHASE(turn.inputNanos);
+            mover->upgrade_pawn(piece, board);
+            if (display){
                 system("clear");
                 std::cout << board << "\n";
             }
-            if (p1.check_mate(p2, board)){
-                break;
+        }
+        positions.push_back(board.hash_key());
+        if (recorder){
+            recorder->add_move(mover->return_last_move());
+        }
+        std::swap(mover, opponent);
+        bool goesOn;
+        {
+            TIME_PHASE(turn.checkmateNanos);
+            goesOn = !check_over();
+        }
+#ifdef INSTRUMENT
+        turn.calls = hot_path_counters() - before;
+        turn.validationNanos = turn.calls.validationNanos;
+        turn.inputNanos -= std::min(turn.inputNanos, turn.validationNanos);
+        turnStats.push_back(turn);
+#endif
+        return goesOn;
+    }
+
+    // returns the timing and rules calls of every turn played, empty unless compiled with INSTRUMENT defined
+    const std::vector<TurnStats> &return_turn_stats() const{
+        return turnStats;
+    }
+
+    // writes a summary of where the time of the game's turns went and how often the rules
+    // functions were called
+    void write_report(std::ostream &out) const{
+#ifndef INSTRUMENT
+        out << "turn timing and call counts need a build with INSTRUMENT defined(make chess_instrumented)\n";
+#else
+        if (turnStats.empty()){
+            out << "no turns played\n";
+            return;
+        }
+        const char *names[4] = {"input", "validation", "checkmate test", "render"};
+        uint64_t totals[4] = {0, 0, 0, 0};
+        uint64_t longest[4] = {0, 0, 0, 0};
+        HotPathCounters calls;
+        const TurnStats *slowest = &turnStats[0];
+        for (const TurnStats &turn: turnStats){
+            uint64_t phases[4] = {turn.inputNanos, turn.validationNanos, turn.checkmateNanos, turn.renderNanos};
+            for (int phase = 0; phase < 4; phase++){
+                totals[phase] += phases[phase];
+                longest[phase] = std::max(longest[phase], phases[phase]);
+            }
+            calls += turn.calls;
+            if (turn.total_nanos() > slowest->total_nanos()){
+                slowest = &turn;
             }
         }
-        if (p1Victorius){
-            std::cout << "CHECKMATE!\n" << p1.return_name() << " Wins!" << std::endl;
-        } else{
-            std::cout << "CHECKMATE!\n" << p2.return_name() << " Wins!" << std::endl;
+        double turns = double(turnStats.size());
+        out << std::fixed << std::setprecision(3) << "time of " << turnStats.size() << " turns in ms\n"
+            << "phase               total        mean         max\n";
+        for (int phase = 0; phase < 4; phase++){
+            out << std::left << std::setw(15) << names[phase] << std::right << std::setw(10) << totals[phase] / 1e6
+                << std::setw(12) << totals[phase] / 1e6 / turns << std::setw(12) << longest[phase] / 1e6 << "\n";
+        }
+        out << "slowest turn: ply " << slowest->ply << " by " << slowest->player << ", " << slowest->total_nanos() / 1e6
+            << " ms\ncalls            total   per turn\n";
+        const char *callNames[5] = {"move_piece_possible", "check", "check_mate", "piece_in_way", "ray scans"};
+        uint64_t callCounts[5] = {calls.movePiecePossible, calls.check, calls.checkMate, calls.pieceInWay, calls.rayScans};
+        for (int i = 0; i < 5; i++){
+            out << std::left << std::setw(20) << callNames[i] << std::right << std::setw(8) << callCounts[i]
+                << std::setw(11) << std::setprecision(1) << callCounts[i] / turns << "\n";
+        }
+        out << std::defaultfloat << std::flush;
+#endif
+    }
+
+    // writes the result and every turn's timing and rules calls as one line of JSON
+    void write_stats_json(std::ostream &out) const{
+        out << "{\"result\": \"" << result.score << "\", \"plies\": " << result.plies << ", \"turns\": [";
+        for (size_t i = 0; i < turnStats.size(); i++){
+            const TurnStats &turn = turnStats[i];
+            out << (i > 0 ? ", " : "") << "{\"ply\": " << turn.ply << ", \"input_ns\": " << turn.inputNanos
+                << ", \"validation_ns\": " << turn.validationNanos << ", \"checkmate_ns\": " << turn.checkmateNanos
+                << ", \"render_ns\": " << turn.renderNanos << ", ";
+            turn.calls.write_json(out);
+            out << "}";
+        }
+        out << "]}\n";
+    }
+
+    // simulates chess game
+    // ends when a player gets checkmated, the game is drawn or a player has no move to play
+    GameResult conduct_game(){
+        if (start()){
+            while (play_turn()){}
         }
+        return result;
     }
 };
 
@@ -0,0 +1,248 @@
+#ifndef GAME_RECORD_HPP
+#define GAME_RECORD_HPP
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "move.hpp"
+
+// binary game record files
+// file header: 4 byte magic "CGR1", 4 byte version, 8 byte offset of the index(0 until the file is closed)
+// each game: 2 byte ply count, 1 byte result, 1 byte FEN length(0 for the standard start position),
+// the FEN of the start position, then the moves as 16 bit Move values
+// index: 8 byte game count then the 8 byte file offset of every game
+// numbers are stored little endian whatever the byte order of the cpu writing or reading them
+
+const char RECORD_MAGIC[4] = {'C', 'G', 'R', '1'};
+const uint32_t RECORD_VERSION = 1;
+const size_t RECORD_HEADER_SIZE = 16;
+const size_t RECORD_GAME_HEADER_SIZE = 4;
+
+// stores the low size bytes of a number little endian, whatever the byte order of the cpu
+inline void put_record_number(uint8_t *bytes, uint64_t value, int size){
+    for (int i = 0; i < size; i++){
+        bytes[i] = uint8_t(value >> (8 * i));
+    }
+}
+
+// reads a little endian number of size bytes
+inline uint64_t get_record_number(const uint8_t *bytes, int size){
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++){
+        value |= uint64_t(bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+// result of a recorded game
+enum RecordResult: uint8_t {unfinishedResult, whiteWinResult, redWinResult, drawResult};
+
+// returns the record result of a game score like "1-0", "0-1" or "1/2-1/2"
+inline RecordResult result_from_score(const std::string &score){
+    if (score == "1-0"){
+        return whiteWinResult;
+    } else if (score == "0-1"){
+        return redWinResult;
+    } else if (score == "1/2-1/2"){
+        return drawResult;
+    }
+    return unfinishedResult;
+}
+
+// writes games to a record file as they are played
+// the moves of the current game are buffered until it ends, everything else goes straight to the file
+// the index is written and linked from the file header on close
+class GameRecordWriter{
+    FILE *file;
+    std::vector<uint64_t> offsets;
+    uint64_t position;
+    std::string startFen;
+    std::vector<Move> moves;
+
+    void write(const void *data, size_t size){
+        if (fwrite(data, 1, size, file) != size){
+            throw std::runtime_error("failed writing game record");
+        }
+        position += size;
+    }
+
+    void write_number(uint64_t value, int size){
+        uint8_t bytes[8];
+        put_record_number(bytes, value, size);
+        write(bytes, size);
+    }
+
+    public:
+    // creates or truncates the file, throws std::runtime_error if it can't be opened
+    explicit GameRecordWriter(const std::string &path)
+        : file(fopen(path.c_str(), "wb")), position{0}{
+        if (!file){
+            throw std::runtime_error("can't open " + path);
+        }
+        // large buffer so games are written with few system calls
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        write(RECORD_MAGIC, 4);
+        write_number(RECORD_VERSION, 4);
+        // the index offset, filled in on close
+        write_number(0, 8);
+    }
+
+    GameRecordWriter(const GameRecordWriter &) = delete;
+    GameRecordWriter &operator=(const GameRecordWriter &) = delete;
+
+    ~GameRecordWriter(){
+        if (file){
+            try{
+                close();
+            } catch (const std::runtime_error &){
+            }
+        }
+    }
+
+    // starts a game from the position of a FEN string, or the standard start position if it's empty
+    void begin_game(const std::string &fen = ""){
+        if (fen.size() > 255){
+            throw std::invalid_argument("FEN too long for a game record: " + fen);
+        }
+        startFen = fen;
+        moves.clear();
+    }
+
+    void add_move(Move move){
+        moves.push_back(move);
+    }
+
+    // writes the game started with begin_game
+    void end_game(RecordResult result){
+        if (moves.size() > 0xFFFF){
+            throw std::runtime_error("game too long for a game record");
+        }
+        offsets.push_back(position);
+        uint8_t header[RECORD_GAME_HEADER_SIZE];
+        put_record_number(header, moves.size(), 2);
+        header[2] = uint8_t(result);
+        header[3] = uint8_t(startFen.size());
+        write(header, RECORD_GAME_HEADER_SIZE);
+        write(startFen.data(), startFen.size());
+        std::vector<uint8_t> encoded(moves.size() * sizeof(Move));
+        for (size_t i = 0; i < moves.size(); i++){
+            put_record_number(&encoded[i * sizeof(Move)], moves[i], sizeof(Move));
+        }
+        write(encoded.data(), encoded.size());
+    }
+
+    uint64_t game_count() const{
+        return offsets.size();
+    }
+
+    // writes the index and closes the file
+    void close(){
+        uint64_t indexOffset = position;
+        write_number(offsets.size(), 8);
+        for (uint64_t offset: offsets){
+            write_number(offset, 8);
+        }
+        uint8_t linked[8];
+        put_record_number(linked, indexOffset, 8);
+        bool failed = fseek(file, 8, SEEK_SET) != 0 || fwrite(linked, 8, 1, file) != 1;
+        failed = fclose(file) != 0 || failed;
+        file = nullptr;
+        if (failed){
+            throw std::runtime_error("failed writing game record index");
+        }
+    }
+};
+
+// one game of a memory mapped record file, pointing into the mapping without copying anything
+class RecordedGame{
+    const uint8_t *data;
+
+    public:
+    explicit RecordedGame(const uint8_t *data)
+        : data(data) {}
+
+    int ply_count() const{
+        return int(get_record_number(data, 2));
+    }
+
+    RecordResult result() const{
+        return RecordResult(data[2]);
+    }
+
+    // FEN of the start position, empty for the standard start position
+    std::string start_fen() const{
+        return std::string(reinterpret_cast<const char *>(data + RECORD_GAME_HEADER_SIZE), data[3]);
+    }
+
+    bool standard_start() const{
+        return data[3] == 0;
+    }
+
+    Move move(int ply) const{
+        return Move(get_record_number(data + RECORD_GAME_HEADER_SIZE + data[3] + ply * sizeof(Move), sizeof(Move)));
+    }
+};
+
+// reads a record file through a read only memory mapping, so games are read straight from the
+// page cache with no per game allocation and processes reading the same file share its pages
+class GameRecordReader{
+    std::string path;
+    MappedFile file;
+    const uint8_t *index;
+    uint64_t count;
+    // games lie between the file header and this offset, where the index starts
+    uint64_t gamesEnd;
+
+    public:
+    // throws std::runtime_error if the file can't be mapped or isn't a complete record file
+    explicit GameRecordReader(const std::string &path)
+        : path(path), file(path, true), index(nullptr), count{0}, gamesEnd{0}{
+        const uint8_t *data = file.bytes();
+        size_t size = file.file_size();
+        uint64_t indexOffset = 0;
+        if (size >= RECORD_HEADER_SIZE){
+            indexOffset = get_record_number(data + 8, 8);
+        }
+        if (size < RECORD_HEADER_SIZE || std::memcmp(data, RECORD_MAGIC, 4) != 0
+            || indexOffset == 0 || indexOffset + 8 > size){
+            throw std::runtime_error(path + " is not a complete game record file");
+        }
+        count = get_record_number(data + indexOffset, 8);
+        index = data + indexOffset + 8;
+        gamesEnd = indexOffset;
+        if (count > (size - indexOffset - 8) / 8){
+            throw std::runtime_error(path + " has a damaged index");
+        }
+    }
+
+    uint64_t game_count() const{
+        return count;
+    }
+
+    size_t file_size() const{
+        return file.file_size();
+    }
+
+    // throws std::runtime_error if there is no such game or its offset or length runs outside the games
+    RecordedGame game(uint64_t number) const{
+        if (number >= count){
+            throw std::runtime_error(path + " has no game " + std::to_string(number));
+        }
+        uint64_t offset = get_record_number(index + number * 8, 8);
+        const uint8_t *data = file.bytes();
+        if (offset < RECORD_HEADER_SIZE || offset > gamesEnd || gamesEnd - offset < RECORD_GAME_HEADER_SIZE){
+            throw std::runtime_error(path + " has a damaged index entry for game " + std::to_string(number));
+        }
+        uint64_t plies = get_record_number(data + offset, 2);
+        uint64_t length = RECORD_GAME_HEADER_SIZE + data[offset + 3] + plies * sizeof(Move);
+        if (gamesEnd - offset < length){
+            throw std::runtime_error(path + " has a truncated game " + std::to_string(number));
+        }
+        return RecordedGame(data + offset);
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// counters of calls to the rules functions every turn runs on, and wall clock timing of the phases
+// of each turn of a game, for finding out why a turn is slow without a profiler
+// compiled in only with INSTRUMENT defined(make chess_instrumented), otherwise every counter and
+// timer is an empty statement
+
+// calls made on the calling thread, so games on other threads don't share the counts
+struct HotPathCounters{
+    uint64_t movePiecePossible = 0;
+    uint64_t check = 0;
+    uint64_t checkMate = 0;
+    uint64_t pieceInWay = 0;
+    // piece_blocking_straight_move and piece_blocking_diagnol_move
+    uint64_t rayScans = 0;
+    // nanoseconds spent checking the moves entered at the terminal
+    uint64_t validationNanos = 0;
+
+    HotPathCounters operator-(const HotPathCounters &earlier) const{
+        HotPathCounters difference;
+        difference.movePiecePossible = movePiecePossible - earlier.movePiecePossible;
+        difference.check = check - earlier.check;
+        difference.checkMate = checkMate - earlier.checkMate;
+        difference.pieceInWay = pieceInWay - earlier.pieceInWay;
+        difference.rayScans = rayScans - earlier.rayScans;
+        difference.validationNanos = validationNanos - earlier.validationNanos;
+        return difference;
+    }
+
+    HotPathCounters &operator+=(const HotPathCounters &other){
+        movePiecePossible += other.movePiecePossible;
+        check += other.check;
+        checkMate += other.checkMate;
+        pieceInWay += other.pieceInWay;
+        rayScans += other.rayScans;
+        validationNanos += other.validationNanos;
+        return *this;
+    }
+
+    // writes the counts as the fields of a JSON object
+    void write_json(std::ostream &out) const{
+        out << "\"move_piece_possible\": " << movePiecePossible << ", \"check\": " << check
+            << ", \"check_mate\": " << checkMate << ", \"piece_in_way\": " << pieceInWay
+            << ", \"ray_scans\": " << rayScans;
+    }
+};
+
+inline HotPathCounters &hot_path_counters(){
+    thread_local HotPathCounters counters;
+    return counters;
+}
+
+// adds the nanoseconds from its construction to its destruction to a total
+class PhaseTimer{
+    uint64_t &total;
+    std::chrono::steady_clock::time_point start;
+
+    public:
+    explicit PhaseTimer(uint64_t &total)
+        : total(total), start(std::chrono::steady_clock::now()) {}
+
+    ~PhaseTimer(){
+        total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// wall clock nanoseconds of the phases of one turn of a game and the rules calls made during it
+// input is the time the player took to pick its move, less the time spent validating what was
+// entered, and the checkmate test also covers the draw rules
+struct TurnStats{
+    int ply = 0;
+    std::string player;
+    uint64_t inputNanos = 0;
+    uint64_t validationNanos = 0;
+    uint64_t checkmateNanos = 0;
+    uint64_t renderNanos = 0;
+    HotPathCounters calls;
+
+    uint64_t total_nanos() const{
+        return inputNanos + validationNanos + checkmateNanos + renderNanos;
+    }
+};
+
+#define INSTRUMENT_JOIN(a, b) a##b
+#define INSTRUMENT_NAME(a, b) INSTRUMENT_JOIN(a, b)
+
+#ifdef INSTRUMENT
+// counts a call of a rules function, ex. COUNT_CALL(check)
+#define COUNT_CALL(counter) (++hot_path_counters().counter)
+// times the rest of the enclosing block into a nanosecond total
+#define TIME_PHASE(total) PhaseTimer INSTRUMENT_NAME(phaseTimer, __LINE__)(total)
+#else
+#define COUNT_CALL(counter) ((void)0)
+#define TIME_PHASE(total) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef LINE_SOCKET_HPP
+#define LINE_SOCKET_HPP
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// sockets of the game server and its clients, which talk in lines of text ending in '\n'
+
+// where the server listens: a unix socket path, or a TCP host and port when the path is empty
+struct SocketAddress{
+    std::string unixPath;
+    std::string host = "127.0.0.1";
+    int port = 0;
+
+    std::string describe() const{
+        return unixPath.empty() ? host + ":" + std::to_string(port) : unixPath;
+    }
+};
+
+inline void set_nonblocking(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// sends small writes of a TCP socket right away instead of holding them back to fill packets,
+// as every line is a request or an answer someone waits for
+// unix sockets don't batch writes and ignore it
+inline void set_no_delay(int fd){
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+// fills in the socket address of a unix path or TCP host and port, returning its length
+// throws std::runtime_error if the path is too long or the host isn't an IPv4 address
+inline socklen_t fill_address(const SocketAddress &address, sockaddr_storage &storage){
+    memset(&storage, 0, sizeof(storage));
+    if (!address.unixPath.empty()){
+        sockaddr_un &local = reinterpret_cast<sockaddr_un &>(storage);
+        if (address.unixPath.size() >= sizeof(local.sun_path)){
+            throw std::runtime_error("socket path too long: " + address.unixPath);
+        }
+        local.sun_family = AF_UNIX;
+        strcpy(local.sun_path, address.unixPath.c_str());
+        return sizeof(local);
+    }
+    sockaddr_in &internet = reinterpret_cast<sockaddr_in &>(storage);
+    internet.sin_family = AF_INET;
+    internet.sin_port = htons(uint16_t(address.port));
+    if (inet_pton(AF_INET, address.host.c_str(), &internet.sin_addr) != 1){
+        throw std::runtime_error("not an IPv4 address: " + address.host);
+    }
+    return sizeof(internet);
+}
+
+// opens a non-blocking socket listening on the address, replacing a stale unix socket file
+// throws std::runtime_error if the socket can't be bound
+inline int listen_socket(const SocketAddress &address){
+    sockaddr_storage storage;
+    socklen_t length = fill_address(address, storage);
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0){
+        throw std::runtime_error(std::string("can't create a socket: ") + strerror(errno));
+    }
+    if (address.unixPath.empty()){
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    } else {
+        unlink(address.unixPath.c_str());
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&storage), length) != 0 || listen(fd, SOMAXCONN) != 0){
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("can't listen on " + address.describe() + ": " + error);
+    }
+    return fd;
+}
+
+// connects a non-blocking socket to the address
+// throws std::runtime_error if the connection is refused
+inline int connect_socket(const SocketAddress &address){
+    sockaddr_storage storage;
+    socklen_t length = fill_address(address, storage);
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0){
+        throw std::runtime_error(std::string("can't create a socket: ") + strerror(errno));
+    }
+    if (connect(fd, reinterpret_cast<sockaddr *>(&storage), length) != 0){
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("can't connect to " + address.describe() + ": " + error);
+    }
+    set_nonblocking(fd);
+    if (address.unixPath.empty()){
+        set_no_delay(fd);
+    }
+    return fd;
+}
+
+// takes the first whole line out of buffer into line, without its "\n" or "\r\n"
+// returns false if the buffer has no whole line yet
+inline bool take_line(std::string &buffer, std::string &line){
+    size_t end = buffer.find('\n');
+    if (end == std::string::npos){
+        return false;
+    }
+    line.assign(buffer, 0, end > 0 && buffer[end - 1] == '\r' ? end - 1 : end);
+    buffer.erase(0, end + 1);
+    return true;
+}
+
+#endif
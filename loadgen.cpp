@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+#include "movegen.hpp"
+#include "line_socket.hpp"
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+struct Pair;
+
+// one client of the load, playing one side of its pair's games
+// each client follows its own game from the moves it sends and hears of, as lines of its game
+// may still be on the way when the other client has moved on to the next game
+struct Client{
+    int fd = -1;
+    // 0 plays white and starts each game, 1 joins it as red
+    int seat = 0;
+    Pair *pair = nullptr;
+    unique_ptr<Board> board{new Board()};
+    // red has seen the end of its last game, or hasn't played one yet, and can join the next
+    bool ready = true;
+    string input;
+    string output;
+    Clock::time_point sentAt;
+};
+
+// two clients playing random games against each other through the server, one game after another
+struct Pair{
+    Client clients[2];
+    mt19937_64 random;
+    // game white started that red joins once it is ready
+    int pendingJoin = 0;
+};
+
+// what a load thread measured, merged with the other threads' at the end
+struct LoadTally{
+    uint64_t moves = 0;
+    uint64_t games = 0;
+    uint64_t errors = 0;
+    // microseconds from sending each move until the server's ok
+    vector<double> latencies;
+};
+
+void write_line(int epoll, Client &client, const string &line){
+    bool idle = client.output.empty();
+    client.output += line;
+    client.output += '\n';
+    if (!idle){
+        return;
+    }
+    ssize_t sent = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+    if (sent > 0){
+        client.output.erase(0, sent);
+    }
+    if (!client.output.empty()){
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.ptr = &client;
+        epoll_ctl(epoll, EPOLL_CTL_MOD, client.fd, &event);
+    }
+}
+
+// sends a random legal move of the client's side, if the game isn't over
+void send_move(int epoll, Client &client){
+    MoveList moves;
+    generate_legal_moves(*client.board, moves);
+    if (moves.size() == 0){
+        return;
+    }
+    Move move = moves[client.pair->random() % moves.size()];
+    client.board->play_move(move);
+    client.sentAt = Clock::now();
+    write_line(epoll, client, "move " + move_to_string(move));
+}
+
+void join(int epoll, Client &red, int id){
+    red.ready = false;
+    red.pair->pendingJoin = 0;
+    write_line(epoll, red, "join " + to_string(id));
+}
+
+// answers a line from the server, see server.cpp for the protocol
+// a new game is started after every game that ends before the deadline
+void handle_line(int epoll, Client &client, const string &line, LoadTally &tally, bool starting){
+    Pair &pair = *client.pair;
+    Client &red = pair.clients[1];
+    istringstream words(line);
+    string reply;
+    words >> reply;
+    if (reply == "game"){
+        int id;
+        words >> id;
+        *client.board = Board();
+        if (client.seat == 0){
+            pair.pendingJoin = id;
+            if (red.ready){
+                join(epoll, red, id);
+            }
+        }
+    } else if (reply == "joined"){
+        send_move(epoll, client);
+    } else if (reply == "ok"){
+        tally.moves++;
+        tally.latencies.push_back(chrono::duration<double, micro>(Clock::now() - client.sentAt).count());
+    } else if (reply == "opponent"){
+        string text;
+        words >> text;
+        MoveList moves;
+        generate_legal_moves(*client.board, moves);
+        for (Move move: moves){
+            if (move_to_string(move) == text){
+                client.board->play_move(move);
+                break;
+            }
+        }
+        send_move(epoll, client);
+    } else if (reply == "over"){
+        if (client.seat == 0){
+            tally.games++;
+            if (starting){
+                write_line(epoll, client, "new");
+            }
+        } else if (pair.pendingJoin){
+            join(epoll, red, pair.pendingJoin);
+        } else {
+            red.ready = true;
+        }
+    } else if (reply == "error" && line != "error game over"){
+        // a move sent just as the server ended the game on a draw rule is expected
+        if (tally.errors++ < 5){
+            cerr << "server: " << line << endl;
+        }
+    }
+}
+
+// plays the pairs' games until the deadline, then stops sending and closes the clients
+void run_load(const SocketAddress &address, vector<Pair> &pairs, Clock::time_point deadline, LoadTally &tally){
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    for (Pair &pair: pairs){
+        for (int seat = 0; seat < 2; seat++){
+            Client &client = pair.clients[seat];
+            client.fd = connect_socket(address);
+            client.seat = seat;
+            client.pair = &pair;
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = &client;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, client.fd, &event);
+        }
+        write_line(epoll, pair.clients[0], "new");
+    }
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+    char buffer[65536];
+    while (Clock::now() < deadline){
+        int ready = epoll_wait(epoll, events, MAX_EVENTS, 100);
+        for (int i = 0; i < ready; i++){
+            Client &client = *static_cast<Client *>(events[i].data.ptr);
+            if (events[i].events & EPOLLOUT){
+                ssize_t sent = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+                if (sent > 0){
+                    client.output.erase(0, sent);
+                }
+                if (client.output.empty()){
+                    epoll_event event{};
+                    event.events = EPOLLIN;
+                    event.data.ptr = &client;
+                    epoll_ctl(epoll, EPOLL_CTL_MOD, client.fd, &event);
+                }
+            }
+            if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))){
+                continue;
+            }
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (received <= 0){
+                if (received == 0 || (errno != EAGAIN && errno != EINTR)){
+                    throw runtime_error("the server closed a connection");
+                }
+                continue;
+            }
+            client.input.append(buffer, received);
+            string line;
+            while (take_line(client.input, line)){
+                handle_line(epoll, client, line, tally, Clock::now() < deadline);
+            }
+        }
+    }
+    for (Pair &pair: pairs){
+        for (Client &client: pair.clients){
+            close(client.fd);
+        }
+    }
+    close(epoll);
+}
+
+// usage: loadgen [--unix PATH | --port N [--host ADDRESS]] [--games G] [--threads T] [--seconds S]
+// plays G(default 100) games at once against a server, each between two clients sending random legal
+// moves as soon as it is their turn, from T(default 1) threads for S(default 5) seconds
+// prints moves/sec and the percentiles of the time from sending a move until the server accepts it
+int main(int argc, char *argv[]){
+    SocketAddress address;
+    address.unixPath = "/tmp/chess.sock";
+    int gameCount = 100;
+    int threads = 1;
+    double seconds = 5;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc){
+            address.unixPath = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc){
+            address.port = stoi(argv[++i]);
+            address.unixPath.clear();
+        } else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc){
+            address.host = argv[++i];
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc){
+            gameCount = max(1, stoi(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            threads = max(1, stoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc){
+            seconds = stod(argv[++i]);
+        } else {
+            cerr << "unknown argument " << argv[i] << endl;
+            return 1;
+        }
+    }
+    threads = min(threads, gameCount);
+
+    // thread t plays games t, t + T, t + 2T...
+    vector<vector<Pair>> pairs(threads);
+    for (int game = 0; game < gameCount; game++){
+        pairs[game % threads].emplace_back();
+        pairs[game % threads].back().random.seed(game);
+    }
+    vector<LoadTally> tallies(threads);
+    vector<string> failures(threads);
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + chrono::microseconds(int64_t(seconds * 1e6));
+    vector<thread> pool;
+    for (int id = 0; id < threads; id++){
+        pool.emplace_back([&, id](){
+            try{
+                run_load(address, pairs[id], deadline, tallies[id]);
+            } catch (const runtime_error &error){
+                failures[id] = error.what();
+            }
+        });
+    }
+    for (thread &worker: pool){
+        worker.join();
+    }
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+    for (const string &failure: failures){
+        if (!failure.empty()){
+            cerr << failure << endl;
+            return 1;
+        }
+    }
+
+    LoadTally total;
+    for (LoadTally &tally: tallies){
+        total.moves += tally.moves;
+        total.games += tally.games;
+        total.errors += tally.errors;
+        total.latencies.insert(total.latencies.end(), tally.latencies.begin(), tally.latencies.end());
+    }
+    sort(total.latencies.begin(), total.latencies.end());
+    auto percentile = [&](double p){
+        if (total.latencies.empty()){
+            return 0.0;
+        }
+        return total.latencies[min(total.latencies.size() - 1, size_t(p / 100 * total.latencies.size()))];
+    };
+    cout << address.describe() << ": " << gameCount * 2 << " clients, " << gameCount << " games at once, "
+         << threads << " threads\n"
+         << total.moves << " moves in " << elapsed << "s  " << uint64_t(total.moves / elapsed) << " moves/s  "
+         << total.games << " games finished  " << total.errors << " errors\n"
+         << "latency us  p50 " << percentile(50) << "  p90 " << percentile(90) << "  p99 " << percentile(99)
+         << "  p99.9 " << percentile(99.9) << "  max " << (total.latencies.empty() ? 0.0 : total.latencies.back())
+         << endl;
+    return total.errors == 0 ? 0 : 1;
+}
@@ -1,19 +1,251 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include "game.hpp"
+#include "engine_player.hpp"
+#include "replay_player.hpp"
 using namespace std;
 
-int main(){
+// replays recorded games without prompts or redrawing the board
+// one game per line of moves like "e2e4 e7e5 g1f3", lines starting with # are skipped
+// a game can start from another position with a line like "fen <fen> moves e2e4 e7e5"
+// prints the result of every game and the totals with timing
+// the games are also written to recorder unless it is null, and their turn timing to stats unless it is null
+int run_batch(istream &input, GameRecordWriter *recorder, ostream *stats){
+    int games = 0;
+    int whiteWins = 0;
+    int redWins = 0;
+    int draws = 0;
+    int unfinished = 0;
+    uint64_t plies = 0;
+    auto start = chrono::steady_clock::now();
+    string line;
+    while (getline(input, line)){
+        istringstream words(line);
+        string move;
+        if (!(words >> move) || move[0] == '#'){
+            continue;
+        }
+        string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+        if (move == "fen"){
+            fen.clear();
+            while (words >> move && move != "moves"){
+                fen += (fen.empty() ? "" : " ") + move;
+            }
+        } else {
+            words.seekg(0);
+        }
+        vector<string> moves;
+        while (words >> move){
+            moves.push_back(move);
+        }
+        games++;
+        size_t next = 0;
+        GameResult result;
+        try{
+            Game game(unique_ptr<Player>(new ReplayPlayer("white", "white", moves, next)),
+                      unique_ptr<Player>(new ReplayPlayer("red", "red", moves, next)), fen);
+            game.set_display(false);
+            game.set_recorder(recorder);
+            result = game.conduct_game();
+            if (stats){
+                game.write_stats_json(*stats);
+            }
+        } catch (const invalid_argument &error){
+            result.reason = error.what();
+        }
+        plies += result.plies;
+        if (result.score == "1-0"){
+            whiteWins++;
+        } else if (result.score == "0-1"){
+            redWins++;
+        } else if (result.score == "1/2-1/2"){
+            draws++;
+        } else {
+            unfinished++;
+        }
+        cout << "game " << games << ": " << result.score << " " << result.reason << ", " << result.plies << " plies\n";
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << games << " games: " << whiteWins << " white wins, " << redWins << " red wins, " << draws << " draws, "
+         << unfinished << " unfinished\n" << plies << " plies in " << seconds << "s  "
+         << uint64_t(games / max(seconds, 1e-9)) << " games/s  " << uint64_t(plies / max(seconds, 1e-9)) << " plies/s" << endl;
+    return 0;
+}
+
+// returns the number given to a command line option
+// throws std::invalid_argument naming the option if the value isn't a whole number
+long long option_number(const char *option, const char *value){
+    try{
+        size_t used;
+        long long number = stoll(value, &used);
+        if (value[used] == '\0'){
+            return number;
+        }
+    } catch (const logic_error &){
+    }
+    throw invalid_argument(string("invalid value for ") + option + ": " + value);
+}
+
+// usage: chess [--white-engine] [--red-engine] [--depth N] [--movetime MS] [--threads T] [--fen FEN]
+//              [--book FILE] [--tablebases DIR] [--nnue [FILE]] [--record FILE] [--stats FILE]
+//        chess --batch [file] [--record FILE] [--stats FILE]
+// either side can be played by the computer, searching to depth N and/or for MS milliseconds per move
+// with T threads
+// --fen starts the game from the position of a FEN string instead of the standard start
+// --book lets the computer play from an opening book built with book_build
+// --tablebases lets the computer play endgames perfectly from the tables in a directory built with tb_gen
+// --nnue makes the computer evaluate positions with a neural network, the compiled in one or one from a file
+// --batch replays the games of a file, or stdin without a file, headless
+// --record writes the games played to a binary game record file
+// --stats writes the timing of every turn's phases and its rules calls to a file, one JSON line per game,
+// when built with INSTRUMENT defined, which also prints a report at the end of an interactive game
+int main(int argc, char *argv[]){
+    bool whiteEngine = false;
+    bool redEngine = false;
+    bool batch = false;
+    string batchFile;
+    string recordFile;
+    string statsFile;
+    string bookFile;
+    string tablebaseDirectory;
+    bool useNetwork = false;
+    string networkFile;
+    int threads = 1;
+    string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    SearchLimits limits;
+    limits.moveTime = 1000;
+    try{
+        for (int i = 1; i < argc; i++){
+            if (strcmp(argv[i], "--white-engine") == 0){
+                whiteEngine = true;
+            } else if (strcmp(argv[i], "--red-engine") == 0){
+                redEngine = true;
+            } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc){
+                limits.depth = int(min<long long>(option_number(argv[i], argv[i + 1]), MAX_PLY - 1));
+                limits.moveTime = 0;
+                i++;
+            } else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc){
+                limits.moveTime = option_number(argv[i], argv[i + 1]);
+                i++;
+            } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+                // the same range the uci program offers
+                threads = int(max<long long>(min<long long>(option_number(argv[i], argv[i + 1]), 256), 1));
+                i++;
+            } else if (strcmp(argv[i], "--fen") == 0 && i + 1 < argc){
+                fen = argv[++i];
+            } else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc){
+                bookFile = argv[++i];
+            } else if (strcmp(argv[i], "--tablebases") == 0 && i + 1 < argc){
+                tablebaseDirectory = argv[++i];
+            } else if (strcmp(argv[i], "--nnue") == 0){
+                useNetwork = true;
+                if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0){
+                    networkFile = argv[++i];
+                }
+            } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc){
+                recordFile = argv[++i];
+            } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc){
+                statsFile = argv[++i];
+            } else if (strcmp(argv[i], "--batch") == 0){
+                batch = true;
+                if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0){
+                    batchFile = argv[++i];
+                }
+            }
+        }
+    } catch (const invalid_argument &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    unique_ptr<GameRecordWriter> recorder;
+    unique_ptr<ofstream> stats;
+    unique_ptr<OpeningBook> book;
+    TablebaseSet tablebases;
+    unique_ptr<NnueNetwork> network;
+    try{
+        if (!recordFile.empty()){
+            recorder.reset(new GameRecordWriter(recordFile));
+        }
+        if (!bookFile.empty()){
+            book.reset(new OpeningBook(bookFile));
+        }
+        if (!tablebaseDirectory.empty()){
+            tablebases.load_directory(tablebaseDirectory);
+        }
+        if (useNetwork){
+            network.reset(networkFile.empty() ? new NnueNetwork() : new NnueNetwork(networkFile));
+        }
+        if (!statsFile.empty()){
+            stats.reset(new ofstream(statsFile));
+            if (!*stats){
+                throw runtime_error("can't open " + statsFile);
+            }
+        }
+    } catch (const runtime_error &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    if (batch){
+        ios::sync_with_stdio(false);
+        if (!batchFile.empty()){
+            ifstream file(batchFile);
+            if (!file){
+                cerr << "can't open " << batchFile << endl;
+                return 1;
+            }
+            return run_batch(file, recorder.get(), stats.get());
+        }
+        return run_batch(cin, recorder.get(), stats.get());
+    }
+
     const string RED_TEXT = "\033[31m";
     const string RESET_COLOR = "\033[0m";
     cout << "Welcome to Chess by Larry Tingles!\nWhen entering coordinates please use either one of these two formats: \"0 0\" or \"0,0\"\n";
     cout << "First let me acquire your names!\n";
-    cout << "Player 1 (white) name: ";
-    string p1Name;
-    getline(cin, p1Name);
-    system("clear");
-    cout << RED_TEXT << "Player 2 (red) name: " << RESET_COLOR;
-    string p2Name;
-    getline(cin, p2Name);
-    system("clear");
-    Game game = Game(p1Name, p2Name);
-    game.conduct_game();
-}
\ No newline at end of file
+    string p1Name = "Computer";
+    if (!whiteEngine){
+        cout << "Player 1 (white) name: ";
+        getline(cin, p1Name);
+        system("clear");
+    }
+    string p2Name = "Computer";
+    if (!redEngine){
+        cout << RED_TEXT << "Player 2 (red) name: " << RESET_COLOR;
+        getline(cin, p2Name);
+        system("clear");
+    }
+    unique_ptr<Player> white(new Player("white", p1Name));
+    if (whiteEngine){
+        EnginePlayer *engine = new EnginePlayer("white", p1Name, limits, threads);
+        engine->set_book(book.get());
+        engine->set_tablebases(&tablebases);
+        engine->set_network(network.get());
+        white.reset(engine);
+    }
+    unique_ptr<Player> red(new Player("red", p2Name));
+    if (redEngine){
+        EnginePlayer *engine = new EnginePlayer("red", p2Name, limits, threads);
+        engine->set_book(book.get());
+        engine->set_tablebases(&tablebases);
+        engine->set_network(network.get());
+        red.reset(engine);
+    }
+    unique_ptr<Game> game;
+    try{
+        game.reset(new Game(move(white), move(red), fen));
+    } catch (const invalid_argument &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    game->set_recorder(recorder.get());
+    game->conduct_game();
+#ifdef INSTRUMENT
+    game->write_report(cout);
+#endif
+    if (stats){
+        game->write_stats_json(*stats);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// read only memory mapping of a whole file
+// pages are read from the page cache on demand and shared by every process mapping the same file
+class MappedFile{
+    const uint8_t *data;
+    size_t size;
+
+    public:
+    // throws std::runtime_error if the file can't be opened or mapped
+    // sequential hints the kernel to read ahead as the file will be read from start to end
+    explicit MappedFile(const std::string &path, bool sequential = false)
+        : data(nullptr), size{0}{
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            throw std::runtime_error("can't open " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0){
+            ::close(fd);
+            throw std::runtime_error("can't read the size of " + path);
+        }
+        size = info.st_size;
+        if (size == 0){
+            // an empty file can't be mapped and needs no mapping
+            ::close(fd);
+            return;
+        }
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED){
+            throw std::runtime_error("can't map " + path);
+        }
+        data = static_cast<const uint8_t *>(mapping);
+        madvise(mapping, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile(){
+        if (data){
+            munmap(const_cast<uint8_t *>(data), size);
+        }
+    }
+
+    const uint8_t *bytes() const{
+        return data;
+    }
+
+    const char *chars() const{
+        return reinterpret_cast<const char *>(data);
+    }
+
+    size_t file_size() const{
+        return size;
+    }
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef MOVE_HPP
+#define MOVE_HPP
+#include <cstdint>
+#include <string>
+#include "bitboard.hpp"
+
+// a move packed into 16 bits
+// bits 0-5 hold the square moved from, bits 6-11 the square moved to and bits 12-15 the move flags
+typedef uint16_t Move;
+
+// move flags stored in the top 4 bits of a move
+// the 4 bit is set for every capture and the 8 bit for every promotion
+// the low 2 bits of a promotion hold the piece type promoted to minus one(knight)
+enum MoveFlag{
+    quietMove = 0, doublePawnPush = 1, kingCastle = 2, queenCastle = 3,
+    captureMove = 4, enPassant = 5,
+    knightPromotion = 8, bishopPromotion = 9, rookPromotion = 10, queenPromotion = 11,
+    knightPromotionCapture = 12, bishopPromotionCapture = 13, rookPromotionCapture = 14, queenPromotionCapture = 15
+};
+
+const Move NULL_MOVE = 0;
+
+// packs a move from its from square, to square and flags
+constexpr Move encode_move(int from, int to, int flags){
+    return Move(from | (to << 6) | (flags << 12));
+}
+
+constexpr int move_from(Move move){
+    return move & 63;
+}
+
+constexpr int move_to(Move move){
+    return (move >> 6) & 63;
+}
+
+constexpr int move_flags(Move move){
+    return move >> 12;
+}
+
+constexpr bool is_capture(Move move){
+    return move_flags(move) & captureMove;
+}
+
+constexpr bool is_promotion(Move move){
+    return move_flags(move) & knightPromotion;
+}
+
+// returns the piece type(as a PieceType value) a promotion move promotes to
+constexpr int promotion_type(Move move){
+    return (move_flags(move) & 3) + 1;
+}
+
+// returns the name of a square in algebraic notation ex. square 0(row 0, column 0) is "a8"
+inline std::string square_name(int square){
+    return std::string{char('a' + square_y(square)), char('8' - square_x(square))};
+}
+
+// returns a move in coordinate notation ex. "e2e4" or "e7e8q"
+inline std::string move_to_string(Move move){
+    std::string str = square_name(move_from(move)) + square_name(move_to(move));
+    if (is_promotion(move)){
+        str += "nbrq"[promotion_type(move) - 1];
+    }
+    return str;
+}
+
+
+// fixed capacity list of moves filled by the move generator
+// no position has more than 218 legal moves so 256 entries never overflow
+class MoveList{
+    Move moves[256];
+    int count;
+
+    public:
+    MoveList()
+        : count{0} {}
+
+    void add(Move move){
+        moves[count++] = move;
+    }
+
+    void clear(){
+        count = 0;
+    }
+
+    int size() const{
+        return count;
+    }
+
+    Move operator[](int index) const{
+        return moves[index];
+    }
+
+    Move *begin(){
+        return moves;
+    }
+
+    Move *end(){
+        return moves + count;
+    }
+
+    const Move *begin() const{
+        return moves;
+    }
+
+    const Move *end() const{
+        return moves + count;
+    }
+};
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef MOVEGEN_HPP
+#define MOVEGEN_HPP
+#include "board.hpp"
+#include "move.hpp"
+
+// adds the four promotions of a pawn moving from one square to another
+inline void add_promotions(MoveList &list, int from, int to, bool capture){
+    int flags = capture ? knightPromotionCapture : knightPromotion;
+    for (int piece = 0; piece < 4; piece++){
+        list.add(encode_move(from, to, flags + piece));
+    }
+}
+
+// adds a move to every square in targets, flagging the ones that take an opponents piece
+inline void add_moves(MoveList &list, int from, Bitboard targets, Bitboard enemy){
+    while (targets){
+        int to = pop_lsb(targets);
+        list.add(encode_move(from, to, (enemy & square_bb(to)) ? captureMove : quietMove));
+    }
+}
+
+// fills list with every pseudo legal move for the team to move
+// pseudo legal moves follow the movement rules of each piece but may leave the king under check
+inline void generate_pseudo_legal_moves(const Board &board, MoveList &list){
+    TileOwner us = board.side_to_move();
+    TileOwner them = TileOwner(us ^ 1);
+    Bitboard own = board.pieces(us);
+    Bitboard enemy = board.pieces(them);
+    Bitboard occupied = board.occupancy();
+
+    // pawns move towards row 0 for white and row 7 for red
+    int forward = us == white ? -8 : 8;
+    Bitboard startRow = row_bb(us == white ? 6 : 1);
+    Bitboard lastRow = row_bb(us == white ? 0 : 7);
+    int epSquare = board.en_passant_square();
+    Bitboard pawns = board.pieces(us, pawn);
+    while (pawns){
+        int from = pop_lsb(pawns);
+        int to = from + forward;
+        if (!(occupied & square_bb(to))){
+            if (lastRow & square_bb(to)){
+                add_promotions(list, from, to, false);
+            } else {
+                list.add(encode_move(from, to, quietMove));
+                if ((startRow & square_bb(from)) && !(occupied & square_bb(to + forward))){
+                    list.add(encode_move(from, to + forward, doublePawnPush));
+                }
+            }
+        }
+        Bitboard captures = pawn_attacks(us, from) & enemy;
+        while (captures){
+            to = pop_lsb(captures);
+            if (lastRow & square_bb(to)){
+                add_promotions(list, from, to, true);
+            } else {
+                list.add(encode_move(from, to, captureMove));
+            }
+        }
+        if (epSquare != NO_SQUARE && (pawn_attacks(us, from) & square_bb(epSquare))){
+            list.add(encode_move(from, epSquare, enPassant));
+        }
+    }
+
+    Bitboard knights = board.pieces(us, knight);
+    while (knights){
+        int from = pop_lsb(knights);
+        add_moves(list, from, knight_attacks(from) & ~own, enemy);
+    }
+    Bitboard bishops = board.pieces(us, bishop);
+    while (bishops){
+        int from = pop_lsb(bishops);
+        add_moves(list, from, bishop_attacks(from, occupied) & ~own, enemy);
+    }
+    Bitboard rooks = board.pieces(us, rook);
+    while (rooks){
+        int from = pop_lsb(rooks);
+        add_moves(list, from, rook_attacks(from, occupied) & ~own, enemy);
+    }
+    Bitboard queens = board.pieces(us, queen);
+    while (queens){
+        int from = pop_lsb(queens);
+        add_moves(list, from, queen_attacks(from, occupied) & ~own, enemy);
+    }
+    int kingSquare = board.king_square(us);
+    add_moves(list, kingSquare, king_attacks(kingSquare) & ~own, enemy);
+
+    // castling requires the squares between king and rook to be empty and the king
+    // not to be under check or pass through a square under attack
+    // red's rights are shifted down so that they line up with white's bits
+    int rights = board.castling_rights() >> (us == white ? 0 : 2);
+    if ((rights & (whiteKingside | whiteQueenside)) && !board.square_attacked(kingSquare, them)){
+        if ((rights & whiteKingside) && !(occupied & (square_bb(kingSquare + 1) | square_bb(kingSquare + 2)))
+            && !board.square_attacked(kingSquare + 1, them)){
+            list.add(encode_move(kingSquare, kingSquare + 2, kingCastle));
+        }
+        if ((rights & whiteQueenside)
+            && !(occupied & (square_bb(kingSquare - 1) | square_bb(kingSquare - 2) | square_bb(kingSquare - 3)))
+            && !board.square_attacked(kingSquare - 1, them)){
+            list.add(encode_move(kingSquare, kingSquare - 2, queenCastle));
+        }
+    }
+}
+
+// what keeps moves of the team to move from being legal, worked out once for all of a position's moves
+struct CheckInfo{
+    int kingSquare;
+    // enemy pieces attacking the king
+    Bitboard checkers;
+    // own pieces standing alone between the king and an enemy slider lined up with it
+    Bitboard pinned;
+    // squares a piece other than the king can move to: any square when not under check, the checking
+    // piece or a square between it and the king under a single check, none under double check
+    Bitboard evasionMask;
+};
+
+inline CheckInfo check_info(const Board &board){
+    TileOwner us = board.side_to_move();
+    TileOwner them = TileOwner(us ^ 1);
+    Bitboard occupied = board.occupancy();
+    Bitboard diagonal = board.pieces(them, bishop) | board.pieces(them, queen);
+    Bitboard straight = board.pieces(them, rook) | board.pieces(them, queen);
+    CheckInfo info;
+    info.kingSquare = board.king_square(us);
+    // an enemy pawn attacks the king if a pawn of ours on the king's square would attack it
+    info.checkers = (pawn_attacks(us, info.kingSquare) & board.pieces(them, pawn))
+        | (knight_attacks(info.kingSquare) & board.pieces(them, knight))
+        | (bishop_attacks(info.kingSquare, occupied) & diagonal)
+        | (rook_attacks(info.kingSquare, occupied) & straight);
+
+    // a slider seeing the king across an empty board pins the piece between them if it is the only one
+    info.pinned = 0;
+    Bitboard snipers = (bishop_attacks(info.kingSquare, 0) & diagonal) | (rook_attacks(info.kingSquare, 0) & straight);
+    while (snipers){
+        Bitboard blockers = between_bb(info.kingSquare, pop_lsb(snipers)) & occupied;
+        if (pop_count(blockers) == 1){
+            info.pinned |= blockers & board.pieces(us);
+        }
+    }
+
+    if (!info.checkers){
+        info.evasionMask = ~Bitboard(0);
+    } else if (pop_count(info.checkers) == 1){
+        info.evasionMask = info.checkers | between_bb(info.kingSquare, lsb(info.checkers));
+    } else {
+        info.evasionMask = 0;
+    }
+    return info;
+}
+
+// returns if a pseudo legal move doesn't leave the moving team's king under check
+// the move is made on the board and unmade so the board is handed back unchanged
+inline bool is_legal(Board &board, Move move){
+    TileOwner us = board.side_to_move();
+    board.make_move(move);
+    bool legal = !board.square_attacked(board.king_square(us), TileOwner(us ^ 1));
+    board.unmake_move(move);
+    return legal;
+}
+
+// returns if a pseudo legal move is legal given the check info of its position
+// any other piece has to land in the evasion mask and a pinned piece has to stay on the line of its pin,
+// while king moves and en passant, which can uncover the king along the row of both pawns, are still
+// made on the board and checked
+inline bool is_legal(Board &board, Move move, const CheckInfo &info){
+    int from = move_from(move);
+    if (from == info.kingSquare || move_flags(move) == enPassant){
+        return is_legal(board, move);
+    }
+    Bitboard to = square_bb(move_to(move));
+    return (info.evasionMask & to)
+        && (!(info.pinned & square_bb(from)) || (line_bb(info.kingSquare, from) & to));
+}
+
+// fills list with every legal move for the team to move
+// each pseudo legal move is kept if it does not leave the moving team's king under check
+inline void generate_legal_moves(Board &board, MoveList &list){
+    MoveList pseudoLegal;
+    generate_pseudo_legal_moves(board, pseudoLegal);
+    CheckInfo info = check_info(board);
+    for (Move move: pseudoLegal){
+        if (is_legal(board, move, info)){
+            list.add(move);
+        }
+    }
+}
+
+// returns if the team to move has any legal move, stopping at the first one found
+inline bool has_legal_move(Board &board){
+    MoveList pseudoLegal;
+    generate_pseudo_legal_moves(board, pseudoLegal);
+    CheckInfo info = check_info(board);
+    for (Move move: pseudoLegal){
+        if (is_legal(board, move, info)){
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,395 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "board.hpp"
+#include "mapped_file.hpp"
+
+// efficiently updatable neural network evaluation
+// 768 inputs, one per team, piece type and square, seen from each team's side of the board, feed
+// a 128 wide int16 accumulator per team that is kept up to date by adding and subtracting weight rows
+// as pieces move. Each evaluation clips both accumulators to 0..127, the team to move's first,
+// and runs them through a 256 -> 32 int8 affine layer, another clip and a 32 -> 1 output layer
+// the integer kernels come in AVX2, SSE4.1 and plain versions that give bit for bit the same results,
+// the fastest the cpu supports being chosen when the program starts, other cpus than x86 using the plain ones
+
+const int NNUE_INPUTS = 768;
+const int NNUE_HIDDEN = 128;
+const int NNUE_L1_INPUTS = 2 * NNUE_HIDDEN;
+const int NNUE_L1_OUTPUTS = 32;
+// the affine layers' sums are shifted down by this before clipping
+const int NNUE_L1_SHIFT = 6;
+const int NNUE_CLIP = 127;
+// the network's output divided by this is the score in centipawns
+const int NNUE_OUTPUT_DIVISOR = 8;
+const char NNUE_MAGIC[4] = {'C', 'N', 'N', '1'};
+
+struct NnueWeights{
+    alignas(64) int16_t featureWeights[NNUE_INPUTS][NNUE_HIDDEN];
+    alignas(64) int16_t featureBiases[NNUE_HIDDEN];
+    alignas(64) int8_t hiddenWeights[NNUE_L1_OUTPUTS][NNUE_L1_INPUTS];
+    alignas(64) int32_t hiddenBiases[NNUE_L1_OUTPUTS];
+    alignas(64) int8_t outputWeights[NNUE_L1_OUTPUTS];
+    int32_t outputBias;
+};
+
+// accumulators of both teams for one position
+struct NnueAccumulator{
+    alignas(64) int16_t values[2][NNUE_HIDDEN];
+};
+
+// returns the input of a piece seen from a team's side, the team's own pieces first and the
+// board turned around for red so both teams see their pieces moving up the board
+constexpr int nnue_feature(int perspective, int owner, int type, int square){
+    return ((owner != perspective) * 6 + type) * 64 + (perspective == white ? square : square ^ 56);
+}
+
+// builds the compiled in network, which has no training behind it: it reproduces the piece-square
+// evaluation, midgame and endgame averaged, in units of 8 centipawns
+// per team and side 17 accumulator values sum the pieces, one per pawn file and two per other piece type
+// each holding half, so they stay inside the clipping range, and the king's carries an offset to stay
+// positive. The hidden layer takes our sum minus theirs from both sides in steps of 127 so the
+// output can rebuild scores up to +-40 pawns
+// built when a network is made rather than at compile time, which would slow down every build
+inline NnueWeights build_default_nnue_weights(){
+    NnueWeights weights{};
+    const int KING_OFFSET = 16;
+    for (int side = 0; side < 2; side++){
+        int base = side * 17;
+        for (int type = pawn; type <= king; type++){
+            for (int square = 0; square < 64; square++){
+                // the tables are written from white's side, the other team reads them upside down
+                int tableSquare = side == 0 ? square : square ^ 56;
+                int value = MIDGAME_VALUES[type] + MIDGAME_TABLES[type][tableSquare]
+                    + ENDGAME_VALUES[type] + ENDGAME_TABLES[type][tableSquare];
+                // averaged and in units of 8 centipawns, rounded to nearest
+                int units = value >= 0 ? (value + 8) / 16 : -((-value + 8) / 16);
+                // the input of our or their piece on the square
+                int16_t *row = weights.featureWeights[side * 6 * 64 + type * 64 + square];
+                if (type == pawn){
+                    row[base + (square & 7)] = int16_t(units);
+                } else if (type == king){
+                    row[base + 16] = int16_t(units);
+                } else {
+                    int neuron = base + 8 + 2 * (type - knight);
+                    row[neuron] = int16_t(units / 2);
+                    row[neuron + 1] = int16_t(units - units / 2);
+                }
+            }
+        }
+        weights.featureBiases[base + 16] = KING_OFFSET;
+    }
+    for (int step = 0; step < 4; step++){
+        for (int i = 0; i < 34; i++){
+            int sign = i < 17 ? 1 : -1;
+            // the other team's accumulator sees the same sum with the roles swapped
+            weights.hiddenWeights[step][i] = int8_t(32 * sign);
+            weights.hiddenWeights[step][NNUE_HIDDEN + i] = int8_t(-32 * sign);
+            weights.hiddenWeights[4 + step][i] = int8_t(-32 * sign);
+            weights.hiddenWeights[4 + step][NNUE_HIDDEN + i] = int8_t(32 * sign);
+        }
+        weights.hiddenBiases[step] = -NNUE_CLIP * step * (1 << NNUE_L1_SHIFT);
+        weights.hiddenBiases[4 + step] = -NNUE_CLIP * step * (1 << NNUE_L1_SHIFT);
+        weights.outputWeights[step] = 64;
+        weights.outputWeights[4 + step] = -64;
+    }
+    return weights;
+}
+
+// integer kernels of the network
+struct NnueKernels{
+    const char *name;
+    // adds or subtracts a weight row to an accumulator, wrapping around like int16 arithmetic
+    void (*add)(int16_t *accumulator, const int16_t *row);
+    void (*subtract)(int16_t *accumulator, const int16_t *row);
+    // clips NNUE_HIDDEN accumulator values to 0..NNUE_CLIP
+    void (*clip)(const int16_t *in, uint8_t *out);
+    // out[o] = biases[o] + sum of in[i] * weights[o * inputs + i], inputs being a multiple of 32
+    void (*affine)(const uint8_t *in, const int8_t *weights, const int32_t *biases, int32_t *out,
+                   int inputs, int outputs);
+};
+
+inline void scalar_add(int16_t *accumulator, const int16_t *row){
+    for (int i = 0; i < NNUE_HIDDEN; i++){
+        accumulator[i] = int16_t(accumulator[i] + row[i]);
+    }
+}
+
+inline void scalar_subtract(int16_t *accumulator, const int16_t *row){
+    for (int i = 0; i < NNUE_HIDDEN; i++){
+        accumulator[i] = int16_t(accumulator[i] - row[i]);
+    }
+}
+
+inline void scalar_clip(const int16_t *in, uint8_t *out){
+    for (int i = 0; i < NNUE_HIDDEN; i++){
+        out[i] = uint8_t(std::min<int>(std::max<int>(in[i], 0), NNUE_CLIP));
+    }
+}
+
+inline void scalar_affine(const uint8_t *in, const int8_t *weights, const int32_t *biases, int32_t *out,
+                          int inputs, int outputs){
+    for (int o = 0; o < outputs; o++){
+        int32_t sum = biases[o];
+        for (int i = 0; i < inputs; i++){
+            sum += in[i] * weights[o * inputs + i];
+        }
+        out[o] = sum;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.1"))) inline void sse4_add(int16_t *accumulator, const int16_t *row){
+    for (int i = 0; i < NNUE_HIDDEN; i += 8){
+        __m128i *target = reinterpret_cast<__m128i *>(accumulator + i);
+        *target = _mm_add_epi16(*target, _mm_load_si128(reinterpret_cast<const __m128i *>(row + i)));
+    }
+}
+
+__attribute__((target("sse4.1"))) inline void sse4_subtract(int16_t *accumulator, const int16_t *row){
+    for (int i = 0; i < NNUE_HIDDEN; i += 8){
+        __m128i *target = reinterpret_cast<__m128i *>(accumulator + i);
+        *target = _mm_sub_epi16(*target, _mm_load_si128(reinterpret_cast<const __m128i *>(row + i)));
+    }
+}
+
+__attribute__((target("sse4.1"))) inline void sse4_clip(const int16_t *in, uint8_t *out){
+    for (int i = 0; i < NNUE_HIDDEN; i += 16){
+        // packing saturates to -128..127 so only the lower bound is left to apply
+        __m128i packed = _mm_packs_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(in + i)),
+                                         _mm_load_si128(reinterpret_cast<const __m128i *>(in + i + 8)));
+        _mm_store_si128(reinterpret_cast<__m128i *>(out + i), _mm_max_epi8(packed, _mm_setzero_si128()));
+    }
+}
+
+__attribute__((target("sse4.1"))) inline void sse4_affine(const uint8_t *in, const int8_t *weights,
+                                                          const int32_t *biases, int32_t *out, int inputs, int outputs){
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int o = 0; o < outputs; o++){
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < inputs; i += 16){
+            // pairs of products can't saturate 16 bits as inputs are at most 127
+            __m128i products = _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + o * inputs + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+        out[o] = biases[o] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+__attribute__((target("avx2"))) inline void avx2_add(int16_t *accumulator, const int16_t *row){
+    for (int i = 0; i < NNUE_HIDDEN; i += 16){
+        __m256i *target = reinterpret_cast<__m256i *>(accumulator + i);
+        *target = _mm256_add_epi16(*target, _mm256_load_si256(reinterpret_cast<const __m256i *>(row + i)));
+    }
+}
+
+__attribute__((target("avx2"))) inline void avx2_subtract(int16_t *accumulator, const int16_t *row){
+    for (int i = 0; i < NNUE_HIDDEN; i += 16){
+        __m256i *target = reinterpret_cast<__m256i *>(accumulator + i);
+        *target = _mm256_sub_epi16(*target, _mm256_load_si256(reinterpret_cast<const __m256i *>(row + i)));
+    }
+}
+
+__attribute__((target("avx2"))) inline void avx2_clip(const int16_t *in, uint8_t *out){
+    for (int i = 0; i < NNUE_HIDDEN; i += 32){
+        __m256i packed = _mm256_packs_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(in + i)),
+                                            _mm256_load_si256(reinterpret_cast<const __m256i *>(in + i + 16)));
+        // packing works within each 128 bit lane so the middle quarters come out swapped
+        packed = _mm256_permute4x64_epi64(_mm256_max_epi8(packed, _mm256_setzero_si256()), 0xD8);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+}
+
+__attribute__((target("avx2"))) inline void avx2_affine(const uint8_t *in, const int8_t *weights,
+                                                        const int32_t *biases, int32_t *out, int inputs, int outputs){
+    const __m256i ones = _mm256_set1_epi16(1);
+    int o = 0;
+    // four outputs at a time share the loads of the inputs and one horizontal sum
+    for (; o + 4 <= outputs; o += 4){
+        __m256i sums[4];
+        for (int k = 0; k < 4; k++){
+            sums[k] = _mm256_setzero_si256();
+        }
+        for (int i = 0; i < inputs; i += 32){
+            __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            for (int k = 0; k < 4; k++){
+                __m256i products = _mm256_maddubs_epi16(input,
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + (o + k) * inputs + i)));
+                sums[k] = _mm256_add_epi32(sums[k], _mm256_madd_epi16(products, ones));
+            }
+        }
+        __m256i pairs = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]), _mm256_hadd_epi32(sums[2], sums[3]));
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+        total = _mm_add_epi32(total, _mm_loadu_si128(reinterpret_cast<const __m128i *>(biases + o)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + o), total);
+    }
+    for (; o < outputs; o++){
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < inputs; i += 32){
+            __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + o * inputs + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_hadd_epi32(half, half);
+        half = _mm_hadd_epi32(half, half);
+        out[o] = biases[o] + _mm_cvtsi128_si32(half);
+    }
+}
+
+const NnueKernels SSE4_KERNELS = {"sse4.1", sse4_add, sse4_subtract, sse4_clip, sse4_affine};
+const NnueKernels AVX2_KERNELS = {"avx2", avx2_add, avx2_subtract, avx2_clip, avx2_affine};
+#endif
+const NnueKernels SCALAR_KERNELS = {"scalar", scalar_add, scalar_subtract, scalar_clip, scalar_affine};
+
+// returns the fastest kernels the cpu running the program supports
+inline const NnueKernels &best_nnue_kernels(){
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")){
+        return AVX2_KERNELS;
+    }
+    if (__builtin_cpu_supports("sse4.1")){
+        return SSE4_KERNELS;
+    }
+#endif
+    return SCALAR_KERNELS;
+}
+
+// network weights with the kernels that run them
+// shared read only by every search thread, each keeping its own accumulators
+class NnueNetwork{
+    std::unique_ptr<NnueWeights> weights;
+    const NnueKernels *kernels;
+
+    // applies a piece being placed or removed to both teams' accumulators
+    void add_piece(NnueAccumulator &accumulator, TileOwner owner, PieceType type, int square) const{
+        for (int perspective = white; perspective <= red; perspective++){
+            kernels->add(accumulator.values[perspective],
+                         weights->featureWeights[nnue_feature(perspective, owner, type, square)]);
+        }
+    }
+
+    void remove_piece(NnueAccumulator &accumulator, TileOwner owner, PieceType type, int square) const{
+        for (int perspective = white; perspective <= red; perspective++){
+            kernels->subtract(accumulator.values[perspective],
+                              weights->featureWeights[nnue_feature(perspective, owner, type, square)]);
+        }
+    }
+
+    public:
+    // the compiled in network
+    NnueNetwork()
+        : weights(new NnueWeights(build_default_nnue_weights())), kernels(&best_nnue_kernels()) {}
+
+    // a network with other weights, ex. ones being trained
+    explicit NnueNetwork(const NnueWeights &networkWeights)
+        : weights(new NnueWeights(networkWeights)), kernels(&best_nnue_kernels()) {}
+
+    // loads the weights written by save
+    // throws std::runtime_error if the file can't be read or isn't a network of this shape
+    explicit NnueNetwork(const std::string &path)
+        : weights(new NnueWeights()), kernels(&best_nnue_kernels()){
+        MappedFile file(path);
+        const uint8_t *bytes = file.bytes();
+        uint32_t shape[2] = {NNUE_HIDDEN, NNUE_L1_OUTPUTS};
+        if (file.file_size() != sizeof(NNUE_MAGIC) + sizeof(shape) + sizeof(NnueWeights)
+            || std::memcmp(bytes, NNUE_MAGIC, sizeof(NNUE_MAGIC)) != 0
+            || std::memcmp(bytes + sizeof(NNUE_MAGIC), shape, sizeof(shape)) != 0){
+            throw std::runtime_error(path + " is not a network of this shape");
+        }
+        std::memcpy(weights.get(), bytes + sizeof(NNUE_MAGIC) + sizeof(shape), sizeof(NnueWeights));
+    }
+
+    // writes the weights as the magic, the hidden layer sizes and the weights in memory order,
+    // little endian on x86
+    // throws std::runtime_error if the file can't be written
+    void save(const std::string &path) const{
+        FILE *file = fopen(path.c_str(), "wb");
+        if (!file){
+            throw std::runtime_error("can't open " + path);
+        }
+        uint32_t shape[2] = {NNUE_HIDDEN, NNUE_L1_OUTPUTS};
+        bool written = fwrite(NNUE_MAGIC, sizeof(NNUE_MAGIC), 1, file) == 1 && fwrite(shape, sizeof(shape), 1, file) == 1
+            && fwrite(weights.get(), sizeof(NnueWeights), 1, file) == 1;
+        if (fclose(file) != 0 || !written){
+            throw std::runtime_error("failed writing " + path);
+        }
+    }
+
+    // runs the network with other kernels, which must be supported by the cpu
+    void use_kernels(const NnueKernels &kernelSet){
+        kernels = &kernelSet;
+    }
+
+    const NnueKernels &kernel_set() const{
+        return *kernels;
+    }
+
+    // sets an accumulator up from every piece of a position
+    void refresh(const Board &board, NnueAccumulator &accumulator) const{
+        for (int perspective = white; perspective <= red; perspective++){
+            std::memcpy(accumulator.values[perspective], weights->featureBiases, sizeof(weights->featureBiases));
+        }
+        Bitboard occupied = board.occupancy();
+        while (occupied){
+            int square = pop_lsb(occupied);
+            add_piece(accumulator, board.owner_at(square), board.type_at(square), square);
+        }
+    }
+
+    // sets after to the accumulator of the position a move leads to, before being the position's own
+    // board must be the position before the move is made
+    void update(const Board &board, Move move, const NnueAccumulator &before, NnueAccumulator &after) const{
+        after = before;
+        int from = move_from(move);
+        int to = move_to(move);
+        int flags = move_flags(move);
+        TileOwner us = board.owner_at(from);
+        TileOwner them = TileOwner(us ^ 1);
+        PieceType type = board.type_at(from);
+        if (flags == enPassant){
+            remove_piece(after, them, pawn, us == white ? to + 8 : to - 8);
+        } else if (is_capture(move)){
+            remove_piece(after, them, board.type_at(to), to);
+        }
+        remove_piece(after, us, type, from);
+        add_piece(after, us, is_promotion(move) ? PieceType(promotion_type(move)) : type, to);
+        if (flags == kingCastle){
+            remove_piece(after, us, rook, to + 1);
+            add_piece(after, us, rook, to - 1);
+        } else if (flags == queenCastle){
+            remove_piece(after, us, rook, to - 2);
+            add_piece(after, us, rook, to + 1);
+        }
+    }
+
+    // returns the score of a position in centipawns from the point of view of the team to move
+    int evaluate(const NnueAccumulator &accumulator, TileOwner sideToMove) const{
+        alignas(64) uint8_t hidden[NNUE_L1_INPUTS];
+        alignas(64) int32_t sums[NNUE_L1_OUTPUTS];
+        alignas(64) uint8_t clipped[NNUE_L1_OUTPUTS];
+        kernels->clip(accumulator.values[sideToMove], hidden);
+        kernels->clip(accumulator.values[sideToMove ^ 1], hidden + NNUE_HIDDEN);
+        kernels->affine(hidden, &weights->hiddenWeights[0][0], weights->hiddenBiases, sums,
+                        NNUE_L1_INPUTS, NNUE_L1_OUTPUTS);
+        for (int i = 0; i < NNUE_L1_OUTPUTS; i++){
+            clipped[i] = uint8_t(std::min(std::max(sums[i] >> NNUE_L1_SHIFT, 0), NNUE_CLIP));
+        }
+        int32_t output;
+        kernels->affine(clipped, weights->outputWeights, &weights->outputBias, &output, NNUE_L1_OUTPUTS, 1);
+        return output / NNUE_OUTPUT_DIVISOR;
+    }
+};
+
+#endif
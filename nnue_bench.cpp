@@ -0,0 +1,211 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "movegen.hpp"
+#include "search.hpp"
+using namespace std;
+
+// kernel sets the cpu running the benchmark supports, plain first
+vector<const NnueKernels *> supported_kernels(){
+    vector<const NnueKernels *> kernels = {&SCALAR_KERNELS};
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("sse4.1")){
+        kernels.push_back(&SSE4_KERNELS);
+    }
+    if (__builtin_cpu_supports("avx2")){
+        kernels.push_back(&AVX2_KERNELS);
+    }
+#endif
+    return kernels;
+}
+
+// replays every game updating the accumulator move by move and evaluating each position
+// returns the seconds taken, summing the scores into checksum
+double replay(const NnueNetwork &network, const vector<vector<Move>> &games, int64_t &checksum){
+    unique_ptr<Board> board(new Board());
+    NnueAccumulator accumulators[2];
+    checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (const vector<Move> &game: games){
+        *board = Board();
+        network.refresh(*board, accumulators[0]);
+        int current = 0;
+        for (Move move: game){
+            network.update(*board, move, accumulators[current], accumulators[current ^ 1]);
+            board->play_move(move);
+            current ^= 1;
+            checksum += network.evaluate(accumulators[current], board->side_to_move());
+        }
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// runs every position of the games through each kernel set and counts the positions where an
+// incrementally updated accumulator differs from a refreshed one, or a kernel set's accumulator
+// or score differs from the plain kernels'
+size_t check_kernels(NnueNetwork &network, const vector<vector<Move>> &games, const vector<const NnueKernels *> &kernels){
+    unique_ptr<Board> board(new Board());
+    vector<NnueAccumulator> incremental(kernels.size());
+    size_t mismatches = 0;
+    for (const vector<Move> &game: games){
+        *board = Board();
+        for (size_t k = 0; k < kernels.size(); k++){
+            network.use_kernels(*kernels[k]);
+            network.refresh(*board, incremental[k]);
+        }
+        for (Move move: game){
+            int reference = 0;
+            NnueAccumulator before, refreshed;
+            for (size_t k = 0; k < kernels.size(); k++){
+                network.use_kernels(*kernels[k]);
+                before = incremental[k];
+                network.update(*board, move, before, incremental[k]);
+            }
+            board->play_move(move);
+            for (size_t k = 0; k < kernels.size(); k++){
+                network.use_kernels(*kernels[k]);
+                network.refresh(*board, refreshed);
+                int score = network.evaluate(incremental[k], board->side_to_move());
+                if (k == 0){
+                    reference = score;
+                }
+                if (memcmp(&refreshed, &incremental[k], sizeof(refreshed)) != 0
+                    || memcmp(&incremental[0], &incremental[k], sizeof(refreshed)) != 0 || score != reference){
+                    mismatches++;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+// usage: nnue_bench [games] [--weights FILE] [--check] [--save FILE]
+// plays N(default 2000) random games and measures evaluations/sec of the network, updating its
+// accumulators move by move, with each kernel set the cpu supports
+// --weights runs a network loaded from a file instead of the compiled in one
+// --check also checks every kernel set against the plain kernels bit for bit, on the network and on
+// one with random weights that reaches every part of the integer ranges, returning 1 on any difference
+// --save writes the network's weights to a file, ex. to start training from the compiled in network
+int main(int argc, char *argv[]){
+    int gameCount = 2000;
+    bool check = false;
+    string weightsFile;
+    string saveFile;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc){
+            weightsFile = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc){
+            saveFile = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0){
+            check = true;
+        } else {
+            gameCount = stoi(argv[i]);
+        }
+    }
+    unique_ptr<NnueNetwork> network;
+    try{
+        network.reset(weightsFile.empty() ? new NnueNetwork() : new NnueNetwork(weightsFile));
+        if (!saveFile.empty()){
+            network->save(saveFile);
+            cout << "wrote the network to " << saveFile << "\n";
+        }
+    } catch (const runtime_error &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    mt19937_64 random(2024);
+    unique_ptr<Board> board(new Board());
+    vector<vector<Move>> games(gameCount);
+    size_t positions = 0;
+    for (vector<Move> &game: games){
+        *board = Board();
+        for (int ply = 0; ply < 200; ply++){
+            MoveList moves;
+            generate_legal_moves(*board, moves);
+            if (moves.size() == 0){
+                break;
+            }
+            Move move = moves[random() % moves.size()];
+            board->play_move(move);
+            game.push_back(move);
+        }
+        positions += game.size();
+    }
+    cout << positions << " positions from " << gameCount << " random games, default kernels "
+         << best_nnue_kernels().name << "\n";
+
+    vector<const NnueKernels *> kernels = supported_kernels();
+    int64_t reference = 0;
+    bool sameScores = true;
+    for (size_t k = 0; k < kernels.size(); k++){
+        network->use_kernels(*kernels[k]);
+        int64_t checksum;
+        double seconds = replay(*network, games, checksum);
+        reference = k == 0 ? checksum : reference;
+        sameScores = sameScores && checksum == reference;
+        cout << kernels[k]->name << string(8 - strlen(kernels[k]->name), ' ') << seconds * 1e9 / positions
+             << " ns/eval  " << uint64_t(positions / seconds) << " evals/sec, accumulator update included\n";
+    }
+    network->use_kernels(best_nnue_kernels());
+    if (weightsFile.empty()){
+        // the compiled in network rebuilds the averaged piece-square score in steps of 8 centipawns
+        double difference = 0;
+        for (const vector<Move> &game: games){
+            *board = Board();
+            NnueAccumulator accumulator;
+            for (Move move: game){
+                board->play_move(move);
+                network->refresh(*board, accumulator);
+                int midgame = board->midgame_score();
+                int endgame = board->endgame_score();
+                int pieceSquare = (midgame + endgame) / 2 * (board->side_to_move() == white ? 1 : -1);
+                difference += abs(network->evaluate(accumulator, board->side_to_move()) - pieceSquare);
+            }
+        }
+        cout << "compiled in network is " << difference / positions
+             << " centipawns from the averaged piece-square score on average\n";
+    }
+    if (!check){
+        cout << (sameScores ? "scores match" : "SCORES DIFFER") << endl;
+        return sameScores ? 0 : 1;
+    }
+
+    size_t mismatches = check_kernels(*network, games, kernels);
+    cout << "check: " << mismatches << " differences with the network\n";
+    // random weights, small enough in the first layer that the accumulators rarely wrap
+    unique_ptr<NnueWeights> weights(new NnueWeights());
+    NnueWeights &randomWeights = *weights;
+    for (auto &row: randomWeights.featureWeights){
+        for (int16_t &weight: row){
+            weight = int16_t(int(random() % 41) - 20);
+        }
+    }
+    for (int16_t &bias: randomWeights.featureBiases){
+        bias = int16_t(int(random() % 129) - 32);
+    }
+    for (auto &row: randomWeights.hiddenWeights){
+        for (int8_t &weight: row){
+            weight = int8_t(int(random() % 256) - 128);
+        }
+    }
+    for (int32_t &bias: randomWeights.hiddenBiases){
+        bias = int32_t(random() % 200001) - 100000;
+    }
+    for (int8_t &weight: randomWeights.outputWeights){
+        weight = int8_t(int(random() % 256) - 128);
+    }
+    randomWeights.outputBias = int32_t(random() % 2001) - 1000;
+    NnueNetwork randomNetwork(randomWeights);
+    size_t randomMismatches = check_kernels(randomNetwork, games, kernels);
+    cout << "check: " << randomMismatches << " differences with random weights\n";
+    mismatches += randomMismatches;
+    bool ok = mismatches == 0 && sameScores;
+    cout << (ok ? "all kernels match bit for bit" : "KERNELS DIFFER") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+#ifndef OPENING_BOOK_HPP
+#define OPENING_BOOK_HPP
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "board.hpp"
+#include "movegen.hpp"
+#include "polyglot.hpp"
+
+// opening books in the Polyglot .bin layout: 16 byte big endian entries sorted by key,
+// each a 8 byte position key, 2 byte move, 2 byte weight and 4 byte learn value
+// a move is to file bits 0-2, to rank bits 3-5, from file bits 6-8, from rank bits 9-11 and
+// promotion piece bits 12-14(1 knight to 4 queen), castling written as the king taking its own rook
+// positions are keyed with Polyglot's own keys, so books made by other programs work as well as
+// the ones book_build makes from our games
+
+const size_t BOOK_ENTRY_SIZE = 16;
+
+struct BookEntry{
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+inline uint64_t read_big_endian(const uint8_t *bytes, int count){
+    uint64_t value = 0;
+    for (int i = 0; i < count; i++){
+        value = value << 8 | bytes[i];
+    }
+    return value;
+}
+
+inline void write_big_endian(uint8_t *bytes, uint64_t value, int count){
+    for (int i = count - 1; i >= 0; i--){
+        bytes[i] = uint8_t(value);
+        value >>= 8;
+    }
+}
+
+// returns the book encoding of a move
+inline uint16_t book_move(Move move){
+    int from = move_from(move);
+    int to = move_to(move);
+    // castling is the king moving onto its rook
+    if (move_flags(move) == kingCastle){
+        to = from + 3;
+    } else if (move_flags(move) == queenCastle){
+        to = from - 4;
+    }
+    int promotion = is_promotion(move) ? promotion_type(move) : 0;
+    return uint16_t(square_y(to) | (7 - square_x(to)) << 3 | square_y(from) << 6 | (7 - square_x(from)) << 9
+        | promotion << 12);
+}
+
+// position key of a board in a book
+inline uint64_t book_key(const Board &board){
+    return polyglot_key(board);
+}
+
+// read only memory mapped opening book
+// every process using the same book file shares one copy of it in the page cache
+class OpeningBook{
+    MappedFile file;
+    size_t count;
+
+    BookEntry entry(size_t index) const{
+        const uint8_t *bytes = file.bytes() + index * BOOK_ENTRY_SIZE;
+        return {read_big_endian(bytes, 8), uint16_t(read_big_endian(bytes + 8, 2)),
+                uint16_t(read_big_endian(bytes + 10, 2)), uint32_t(read_big_endian(bytes + 12, 4))};
+    }
+
+    public:
+    // throws std::runtime_error if the file can't be mapped
+    explicit OpeningBook(const std::string &path)
+        : file(path), count{file.file_size() / BOOK_ENTRY_SIZE} {}
+
+    size_t entry_count() const{
+        return count;
+    }
+
+    // returns the entries of a position, found by binary search on the key
+    std::vector<BookEntry> entries(uint64_t key) const{
+        size_t low = 0;
+        size_t high = count;
+        while (low < high){
+            size_t middle = low + (high - low) / 2;
+            if (read_big_endian(file.bytes() + middle * BOOK_ENTRY_SIZE, 8) < key){
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        std::vector<BookEntry> found;
+        for (size_t i = low; i < count && entry(i).key == key; i++){
+            found.push_back(entry(i));
+        }
+        return found;
+    }
+
+    // picks one of the book moves of the position at random, weighted by the entries' weights
+    // returns NULL_MOVE if the position isn't in the book or the chosen move isn't legal in it
+    Move probe(Board &board, std::mt19937_64 &random) const{
+        std::vector<BookEntry> found = entries(book_key(board));
+        uint64_t total = 0;
+        for (const BookEntry &bookEntry: found){
+            total += bookEntry.weight;
+        }
+        if (total == 0){
+            return NULL_MOVE;
+        }
+        uint64_t pick = std::uniform_int_distribution<uint64_t>(0, total - 1)(random);
+        uint16_t chosen = 0;
+        for (const BookEntry &bookEntry: found){
+            if (pick < bookEntry.weight){
+                chosen = bookEntry.move;
+                break;
+            }
+            pick -= bookEntry.weight;
+        }
+        MoveList moves;
+        generate_legal_moves(board, moves);
+        for (Move move: moves){
+            if (book_move(move) == chosen){
+                return move;
+            }
+        }
+        return NULL_MOVE;
+    }
+};
+
+// collects position and move counts and writes them out as a sorted book file
+class BookWriter{
+    std::vector<BookEntry> entries;
+
+    public:
+    // adds weight to a move of a position
+    void add(uint64_t key, Move move, uint32_t weight){
+        entries.push_back({key, book_move(move), 0, weight});
+    }
+
+    // merges the entries of each position and move, scales the weights to 16 bits and writes the book
+    // moves with less than minimumWeight in total are left out
+    // throws std::runtime_error if the file can't be written
+    size_t write(const std::string &path, uint32_t minimumWeight = 1){
+        std::sort(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b){
+            return a.key != b.key ? a.key < b.key : a.move < b.move;
+        });
+        // learn holds the summed weight until it's scaled down
+        std::vector<BookEntry> merged;
+        for (const BookEntry &bookEntry: entries){
+            if (!merged.empty() && merged.back().key == bookEntry.key && merged.back().move == bookEntry.move){
+                merged.back().learn += bookEntry.learn;
+            } else {
+                merged.push_back(bookEntry);
+            }
+        }
+        uint32_t largest = 1;
+        for (const BookEntry &bookEntry: merged){
+            largest = std::max(largest, bookEntry.learn);
+        }
+        FILE *file = fopen(path.c_str(), "wb");
+        if (!file){
+            throw std::runtime_error("can't open " + path);
+        }
+        size_t written = 0;
+        for (const BookEntry &bookEntry: merged){
+            if (bookEntry.learn < minimumWeight){
+                continue;
+            }
+            uint64_t weight = std::max<uint64_t>(1, uint64_t(bookEntry.learn) * 0xFFFF / largest);
+            uint8_t bytes[BOOK_ENTRY_SIZE];
+            write_big_endian(bytes, bookEntry.key, 8);
+            write_big_endian(bytes + 8, bookEntry.move, 2);
+            write_big_endian(bytes + 10, weight, 2);
+            write_big_endian(bytes + 12, 0, 4);
+            if (fwrite(bytes, 1, BOOK_ENTRY_SIZE, file) != BOOK_ENTRY_SIZE){
+                fclose(file);
+                throw std::runtime_error("failed writing " + path);
+            }
+            written++;
+        }
+        if (fclose(file) != 0){
+            throw std::runtime_error("failed writing " + path);
+        }
+        return written;
+    }
+};
+
+#endif
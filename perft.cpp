@@ -0,0 +1,371 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "movegen.hpp"
+using namespace std;
+
+// counts the leaf nodes of the legal move tree of a position to the specified depth
+uint64_t perft(Board &board, int depth){
+    MoveList moves;
+    generate_legal_moves(board, moves);
+    if (depth <= 1){
+        return depth == 1 ? moves.size() : 1;
+    }
+    uint64_t nodes = 0;
+    for (Move move: moves){
+        board.make_move(move);
+        nodes += perft(board, depth - 1);
+        board.unmake_move(move);
+    }
+    return nodes;
+}
+
+// cache of subtree leaf counts keyed by hash key and depth, shared by every thread without locking
+// each slot holds the count and depth packed into 64 bits and the hash key xored with them,
+// so a slot torn by two threads writing at once reads as a miss
+class PerftTable{
+    struct Slot{
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    unique_ptr<Slot[]> slots;
+    uint64_t mask;
+
+    const Slot &slot(uint64_t key, int depth) const{
+        return slots[(key ^ (uint64_t(depth) * 0x9E3779B97F4A7C15ull)) & mask];
+    }
+
+    public:
+    explicit PerftTable(size_t megabytes){
+        size_t count = 1;
+        while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024){
+            count *= 2;
+        }
+        slots.reset(new Slot[count]);
+        mask = count - 1;
+        for (size_t i = 0; i < count; i++){
+            slots[i].check.store(0, memory_order_relaxed);
+            slots[i].data.store(0, memory_order_relaxed);
+        }
+    }
+
+    bool probe(uint64_t key, int depth, uint64_t &nodes) const{
+        const Slot &entry = slot(key, depth);
+        uint64_t data = entry.data.load(memory_order_relaxed);
+        if ((entry.check.load(memory_order_relaxed) ^ data) != key || int(data & 0xFF) != depth){
+            return false;
+        }
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes){
+        Slot &entry = const_cast<Slot &>(slot(key, depth));
+        uint64_t data = nodes << 8 | uint64_t(depth);
+        entry.data.store(data, memory_order_relaxed);
+        entry.check.store(key ^ data, memory_order_relaxed);
+    }
+};
+
+// perft that looks up and saves the counts of subtrees two or more plies deep in the table
+uint64_t perft(Board &board, int depth, PerftTable &table){
+    if (depth <= 1){
+        return perft(board, depth);
+    }
+    uint64_t nodes = 0;
+    if (table.probe(board.hash_key(), depth, nodes)){
+        return nodes;
+    }
+    MoveList moves;
+    generate_legal_moves(board, moves);
+    for (Move move: moves){
+        board.make_move(move);
+        nodes += perft(board, depth - 1, table);
+        board.unmake_move(move);
+    }
+    table.store(board.hash_key(), depth, nodes);
+    return nodes;
+}
+
+// subtree below one or two moves from the root
+struct PerftTask{
+    Move moves[2];
+    int moveCount;
+    // index of the root move the subtree belongs to
+    int root;
+};
+
+// work queue of one thread, the owner takes tasks from the back and idle threads steal from the front
+struct PerftQueue{
+    mutex lock;
+    deque<PerftTask> tasks;
+};
+
+struct ParallelPerftResult{
+    uint64_t nodes = 0;
+    // leaf nodes below each root move
+    vector<uint64_t> rootNodes;
+    // leaf nodes counted by each thread
+    vector<uint64_t> threadNodes;
+};
+
+// perft of a position split across threads
+// every subtree below the first two plies(or the first ply when too shallow) is a task, dealt out
+// evenly, and threads that run out of tasks steal from the others so none sit idle while work remains
+// table may be null to count without caching
+ParallelPerftResult parallel_perft(const Board &root, int depth, int threads, PerftTable *table){
+    ParallelPerftResult result;
+    result.threadNodes.assign(threads, 0);
+    Board board = root;
+    MoveList rootMoves;
+    generate_legal_moves(board, rootMoves);
+    result.rootNodes.assign(rootMoves.size(), 0);
+    if (depth <= 1){
+        result.nodes = depth == 1 ? rootMoves.size() : 1;
+        result.rootNodes.assign(rootMoves.size(), 1);
+        result.threadNodes[0] = result.nodes;
+        return result;
+    }
+
+    vector<PerftQueue> queues(threads);
+    int dealt = 0;
+    int split = depth >= 3 ? 2 : 1;
+    for (int i = 0; i < rootMoves.size(); i++){
+        if (split == 1){
+            queues[dealt++ % threads].tasks.push_back({{rootMoves[i], NULL_MOVE}, 1, i});
+            continue;
+        }
+        board.make_move(rootMoves[i]);
+        MoveList replies;
+        generate_legal_moves(board, replies);
+        for (Move reply: replies){
+            queues[dealt++ % threads].tasks.push_back({{rootMoves[i], reply}, 2, i});
+        }
+        board.unmake_move(rootMoves[i]);
+    }
+
+    vector<atomic<uint64_t>> rootNodes(rootMoves.size());
+    auto work = [&](int id){
+        Board threadBoard = root;
+        PerftTask task;
+        while (true){
+            bool found = false;
+            // own queue first, then steal from the others in turn
+            for (int offset = 0; offset < threads && !found; offset++){
+                PerftQueue &queue = queues[(id + offset) % threads];
+                lock_guard<mutex> guard(queue.lock);
+                if (!queue.tasks.empty()){
+                    if (offset == 0){
+                        task = queue.tasks.back();
+                        queue.tasks.pop_back();
+                    } else {
+                        task = queue.tasks.front();
+                        queue.tasks.pop_front();
+                    }
+                    found = true;
+                }
+            }
+            // tasks are only created up front, so empty queues mean the count is done
+            if (!found){
+                return;
+            }
+            for (int i = 0; i < task.moveCount; i++){
+                threadBoard.make_move(task.moves[i]);
+            }
+            int remaining = depth - task.moveCount;
+            uint64_t nodes = table ? perft(threadBoard, remaining, *table) : perft(threadBoard, remaining);
+            for (int i = task.moveCount - 1; i >= 0; i--){
+                threadBoard.unmake_move(task.moves[i]);
+            }
+            rootNodes[task.root].fetch_add(nodes, memory_order_relaxed);
+            result.threadNodes[id] += nodes;
+        }
+    };
+    vector<thread> pool;
+    for (int id = 1; id < threads; id++){
+        pool.emplace_back(work, id);
+    }
+    work(0);
+    for (thread &worker: pool){
+        worker.join();
+    }
+    for (int i = 0; i < rootMoves.size(); i++){
+        result.rootNodes[i] = rootNodes[i].load();
+        result.nodes += result.rootNodes[i];
+    }
+    return result;
+}
+
+// position with the known leaf node counts at depth 1, 2, 3...
+struct PerftPosition{
+    string name;
+    string fen;
+    vector<uint64_t> expected;
+};
+
+// standard perft positions covering castling, en passant, promotions and checks
+const vector<PerftPosition> POSITIONS = {
+    {"start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        {48, 2039, 97862, 4085603, 193690690}},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        {14, 191, 2812, 43238, 674624, 11030083}},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        {6, 264, 9467, 422333, 15833292}},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        {44, 1486, 62379, 2103487, 89941194}},
+    {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        {46, 2079, 89890, 3894594, 164075551}},
+};
+
+double seconds_since(chrono::steady_clock::time_point start){
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// usage: perft [depth] [fen] [--threads N] [--hash MB] [--serial]
+// with only a depth every standard position is searched to that depth(or the deepest known count)
+// and checked against the known results
+// with a FEN the node count below each root move is printed to help track down move generation bugs
+// --threads splits the count across N threads and prints the nodes each thread counted,
+// --hash caches subtree counts in a table of MB megabytes and --serial also times the
+// single threaded perft without a cache, checks both counts agree and reports the speedup
+int main(int argc, char *argv[]){
+    const char *USAGE = "usage: perft [depth] [fen] [--threads N] [--hash MB] [--serial]";
+    int threads = 0;
+    size_t hashMegabytes = 0;
+    bool serial = false;
+    vector<string> arguments;
+    int depth = 4;
+    try{
+        for (int i = 1; i < argc; i++){
+            if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+                threads = max(stoi(argv[++i]), 1);
+            } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc){
+                hashMegabytes = stoul(argv[++i]);
+            } else if (strcmp(argv[i], "--serial") == 0){
+                serial = true;
+            } else if (strcmp(argv[i], "--help") == 0){
+                cout << USAGE << endl;
+                return 0;
+            } else {
+                arguments.push_back(argv[i]);
+            }
+        }
+        if (arguments.size() > 0){
+            depth = stoi(arguments[0]);
+        }
+    } catch (const logic_error &){
+        // stoi and stoul throw invalid_argument for a value that isn't a number and out_of_range for a huge one
+        depth = 0;
+    }
+    if (depth < 1){
+        cerr << USAGE << endl;
+        return 1;
+    }
+    bool parallel = threads > 0 || hashMegabytes > 0;
+    threads = max(threads, 1);
+    unique_ptr<PerftTable> table;
+    if (hashMegabytes > 0){
+        table.reset(new PerftTable(hashMegabytes));
+    }
+
+    // counts one position, returning the leaf nodes below each root move
+    // and reporting the per thread counts and speedup when asked to
+    double serialSeconds = 0;
+    double parallelSeconds = 0;
+    bool countsAgree = true;
+    auto count = [&](const Board &board, int countDepth, MoveList &rootMoves, vector<uint64_t> &rootNodes){
+        Board copy = board;
+        generate_legal_moves(copy, rootMoves);
+        rootNodes.assign(rootMoves.size(), 0);
+        uint64_t serialNodes = 0;
+        if (!parallel || serial){
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < rootMoves.size(); i++){
+                copy.make_move(rootMoves[i]);
+                rootNodes[i] = perft(copy, countDepth - 1);
+                copy.unmake_move(rootMoves[i]);
+                serialNodes += rootNodes[i];
+            }
+            if (countDepth <= 1){
+                serialNodes = countDepth == 1 ? rootMoves.size() : 1;
+            }
+            serialSeconds += seconds_since(start);
+        }
+        if (parallel){
+            auto start = chrono::steady_clock::now();
+            ParallelPerftResult result = parallel_perft(board, countDepth, threads, table.get());
+            parallelSeconds += seconds_since(start);
+            if (serial && result.nodes != serialNodes){
+                countsAgree = false;
+                cout << "  parallel count " << result.nodes << " differs from serial count " << serialNodes << "\n";
+            }
+            rootNodes = result.rootNodes;
+            if (threads > 1){
+                cout << "  nodes per thread:";
+                for (uint64_t nodes: result.threadNodes){
+                    cout << " " << nodes;
+                }
+                cout << "\n";
+            }
+            return result.nodes;
+        }
+        return serialNodes;
+    };
+    auto report_timing = [&](uint64_t nodes){
+        double seconds = parallel ? parallelSeconds : serialSeconds;
+        cout << "\nnodes: " << nodes << "  time: " << seconds << "s  nps: " << uint64_t(nodes / seconds) << endl;
+        if (parallel && serial){
+            cout << "serial time: " << serialSeconds << "s  speedup: " << serialSeconds / parallelSeconds << endl;
+        }
+    };
+
+    if (arguments.size() > 1){
+        unique_ptr<Board> parsed;
+        try{
+            parsed.reset(new Board(arguments[1]));
+        } catch (const invalid_argument &error){
+            cerr << error.what() << endl;
+            return 1;
+        }
+        const Board &board = *parsed;
+        MoveList moves;
+        vector<uint64_t> rootNodes;
+        uint64_t total = count(board, depth, moves, rootNodes);
+        for (int i = 0; i < moves.size(); i++){
+            cout << move_to_string(moves[i]) << ": " << rootNodes[i] << "\n";
+        }
+        report_timing(total);
+        return countsAgree ? 0 : 1;
+    }
+
+    bool allPassed = true;
+    uint64_t totalNodes = 0;
+    for (const auto &position: POSITIONS){
+        int positionDepth = min<int>(depth, position.expected.size());
+        Board board(position.fen);
+        double before = parallel ? parallelSeconds : serialSeconds;
+        MoveList moves;
+        vector<uint64_t> rootNodes;
+        uint64_t nodes = count(board, positionDepth, moves, rootNodes);
+        double seconds = (parallel ? parallelSeconds : serialSeconds) - before;
+        bool passed = nodes == position.expected[positionDepth - 1];
+        allPassed = allPassed && passed;
+        totalNodes += nodes;
+        cout << position.name << " depth " << positionDepth << ": " << nodes
+             << (passed ? " ok" : " MISMATCH expected " + to_string(position.expected[positionDepth - 1]))
+             << "  " << seconds << "s  " << uint64_t(nodes / seconds) << " nps\n";
+    }
+    report_timing(totalNodes);
+    return allPassed && countsAgree ? 0 : 1;
+}
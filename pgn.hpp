@@ -0,0 +1,229 @@
+#ifndef PGN_HPP
+#define PGN_HPP
+#include <cstring>
+#include <string>
+#include <vector>
+#include "board.hpp"
+#include "movegen.hpp"
+#include "game_record.hpp"
+
+const char START_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// outcome of decoding a SAN move against a position
+enum SanStatus{sanOk, sanIllegal, sanAmbiguous};
+
+// finds the legal move a SAN move like "Nf3", "exd5", "O-O-O" or "e8=Q+" stands for
+// check marks and annotations after the move are ignored
+inline SanStatus san_to_move(Board &board, const char *san, size_t length, Move &move){
+    while (length > 0 && (san[length - 1] == '+' || san[length - 1] == '#'
+                          || san[length - 1] == '!' || san[length - 1] == '?')){
+        length--;
+    }
+    // only the moves matching the text are checked for legality
+    MoveList moves;
+    generate_pseudo_legal_moves(board, moves);
+    // castling, accepting zeros as some programs write them
+    if (length >= 3 && (san[0] == 'O' || san[0] == '0')){
+        bool queenside = length >= 5;
+        for (Move candidate: moves){
+            if (move_flags(candidate) == (queenside ? queenCastle : kingCastle) && is_legal(board, candidate)){
+                move = candidate;
+                return sanOk;
+            }
+        }
+        return sanIllegal;
+    }
+
+    PieceType type = pawn;
+    size_t i = 0;
+    if (length > 0 && std::strchr("NBRQK", san[0])){
+        type = symbol_to_type(san[0]);
+        i++;
+    }
+    PieceType promotion = noPiece;
+    if (length >= 2 && std::strchr("NBRQnbrq", san[length - 1]) && type == pawn){
+        promotion = symbol_to_type(san[length - 1]);
+        length -= san[length - 2] == '=' ? 2 : 1;
+    }
+    // the last two characters are the destination, anything between the piece and it disambiguates
+    if (length < i + 2){
+        return sanIllegal;
+    }
+    char toFile = san[length - 2];
+    char toRank = san[length - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8'){
+        return sanIllegal;
+    }
+    int to = make_square('8' - toRank, toFile - 'a');
+    int fromFile = -1;
+    int fromRank = -1;
+    for (; i < length - 2; i++){
+        if (san[i] >= 'a' && san[i] <= 'h'){
+            fromFile = san[i] - 'a';
+        } else if (san[i] >= '1' && san[i] <= '8'){
+            fromRank = '8' - san[i];
+        } else if (san[i] != 'x' && san[i] != '-'){
+            return sanIllegal;
+        }
+    }
+
+    int matches = 0;
+    for (Move candidate: moves){
+        int from = move_from(candidate);
+        if (move_to(candidate) != to || board.type_at(from) != type
+            || (fromFile >= 0 && square_y(from) != fromFile) || (fromRank >= 0 && square_x(from) != fromRank)
+            || move_flags(candidate) == kingCastle || move_flags(candidate) == queenCastle){
+            continue;
+        }
+        if (is_promotion(candidate) ? promotion_type(candidate) != promotion : promotion != noPiece){
+            continue;
+        }
+        if (is_legal(board, candidate)){
+            move = candidate;
+            matches++;
+        }
+    }
+    return matches == 1 ? sanOk : (matches == 0 ? sanIllegal : sanAmbiguous);
+}
+
+// a game read from PGN
+// kept and reused between games by a reader so parsing doesn't allocate once the buffers have grown
+struct PgnGame{
+    // FEN of the start position, empty for the standard start position
+    std::string fen;
+    RecordResult result;
+    std::vector<Move> moves;
+    // why the game couldn't be replayed, empty if every move was legal
+    std::string error;
+};
+
+// returns the first game start at or after from: a tag line starting at the beginning of the text
+// or after a blank line, or end if there are no more games
+inline const char *next_pgn_game(const char *from, const char *begin, const char *end){
+    for (const char *p = from; p < end; p++){
+        p = static_cast<const char *>(std::memchr(p, '[', end - p));
+        if (!p){
+            return end;
+        }
+        if (p == begin){
+            return p;
+        }
+        const char *q = p - 1;
+        if (*q == '\n'){
+            q--;
+            if (q >= begin && *q == '\r'){
+                q--;
+            }
+            if (q < begin || *q == '\n'){
+                return p;
+            }
+        }
+    }
+    return end;
+}
+
+// reads the tags of one game's text and replays its moves on board
+// returns false and describes the problem in game.error if a move is illegal or ambiguous
+inline bool parse_pgn_game(const char *p, const char *end, Board &board, PgnGame &game){
+    game.fen.clear();
+    game.moves.clear();
+    game.error.clear();
+    game.result = unfinishedResult;
+    // tag pairs like [FEN "..."]
+    while (p < end){
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')){
+            p++;
+        }
+        if (p >= end || *p != '['){
+            break;
+        }
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        lineEnd = lineEnd ? lineEnd : end;
+        const char *nameEnd = p + 1;
+        while (nameEnd < lineEnd && *nameEnd != ' '){
+            nameEnd++;
+        }
+        const char *valueStart = static_cast<const char *>(std::memchr(nameEnd, '"', lineEnd - nameEnd));
+        const char *valueEnd = valueStart ? static_cast<const char *>(std::memchr(valueStart + 1, '"', lineEnd - valueStart - 1)) : nullptr;
+        if (valueEnd && nameEnd - p - 1 == 3 && std::memcmp(p + 1, "FEN", 3) == 0){
+            game.fen.assign(valueStart + 1, valueEnd);
+        }
+        p = lineEnd;
+    }
+    try{
+        board.set_fen(game.fen.empty() ? START_FEN : game.fen);
+    } catch (const std::invalid_argument &error){
+        game.error = error.what();
+        return false;
+    }
+
+    // movetext
+    int variationDepth = 0;
+    while (p < end){
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '.'){
+            p++;
+        } else if (c == '{'){
+            // comment
+            const char *close = static_cast<const char *>(std::memchr(p, '}', end - p));
+            p = close ? close + 1 : end;
+        } else if (c == ';'){
+            // comment to the end of the line
+            const char *close = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            p = close ? close + 1 : end;
+        } else if (c == '('){
+            // variations are skipped as only the game's own moves are replayed
+            variationDepth++;
+            p++;
+        } else if (c == ')'){
+            variationDepth--;
+            p++;
+        } else if (c == '$' || c == '*'){
+            // annotation glyph or the result of an unfinished game
+            while (p < end && !std::strchr(" \t\r\n(){};", *p)){
+                p++;
+            }
+        } else if (c >= '0' && c <= '9' && !(c == '0' && end - p >= 3 && std::memcmp(p, "0-0", 3) == 0)){
+            // result, or a move number whose dots are skipped with the whitespace
+            if (end - p >= 3 && std::memcmp(p, "1-0", 3) == 0){
+                game.result = variationDepth == 0 ? whiteWinResult : game.result;
+                p += 3;
+            } else if (end - p >= 3 && std::memcmp(p, "0-1", 3) == 0){
+                game.result = variationDepth == 0 ? redWinResult : game.result;
+                p += 3;
+            } else if (end - p >= 7 && std::memcmp(p, "1/2-1/2", 7) == 0){
+                game.result = variationDepth == 0 ? drawResult : game.result;
+                p += 7;
+            } else {
+                while (p < end && *p >= '0' && *p <= '9'){
+                    p++;
+                }
+            }
+        } else {
+            const char *token = p;
+            while (p < end && !std::strchr(" \t\r\n(){};.", *p)){
+                p++;
+            }
+            if (p == token){
+                // a stray '}' is a token of its own, so every pass moves on
+                p++;
+            }
+            if (variationDepth > 0){
+                continue;
+            }
+            size_t length = p - token;
+            Move move;
+            SanStatus status = san_to_move(board, token, length, move);
+            if (status != sanOk){
+                game.error = std::string(status == sanIllegal ? "illegal" : "ambiguous") + " move "
+                    + std::string(token, length) + " at ply " + std::to_string(game.moves.size() + 1);
+                return false;
+            }
+            board.play_move(move);
+            game.moves.push_back(move);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mapped_file.hpp"
+#include "pgn.hpp"
+using namespace std;
+
+// size of the pieces of the file handed out to the threads
+const size_t CHUNK_SIZE = 1 << 20;
+
+// games a thread replayed from one chunk, kept so they can be recorded in file order
+struct ChunkGames{
+    vector<Move> moves;
+    // start position FEN, result and move count of each game, in order
+    vector<string> fens;
+    vector<RecordResult> results;
+    vector<uint16_t> plyCounts;
+};
+
+// game that couldn't be replayed
+struct BadGame{
+    size_t offset;
+    string error;
+};
+
+// totals of one thread, each on its own cache line
+struct alignas(64) ThreadTotals{
+    uint64_t games = 0;
+    uint64_t plies = 0;
+    vector<BadGame> badGames;
+};
+
+// movetext the parser once got wrong, with whether it replays and how many plies it has
+struct PgnCase{
+    const char *text;
+    bool legal;
+    size_t plies;
+};
+
+const PgnCase PGN_CASES[] = {
+    {"[Event \"?\"]\n\n1. e4 {best by test} e5 2. Nf3 (2. f4 exf4) Nc6 $1 1-0\n", true, 4},
+    // a stray '}' inside a variation used to be read as an empty move forever
+    {"1. e4 ( 1. d4 } ) e5", true, 2},
+    {"1. e4 } e5", false, 1},
+    {"1. e4 e5 2. Ke3 *", false, 2},
+    {"1. e4 e5 2. O-O-O", false, 2},
+};
+
+// replays the parser's regression cases, returns 1 if any gives a different result
+int run_checks(){
+    Board board;
+    PgnGame game;
+    int failures = 0;
+    for (const PgnCase &check: PGN_CASES){
+        const char *end = check.text + strlen(check.text);
+        bool legal = parse_pgn_game(check.text, end, board, game);
+        if (legal != check.legal || game.moves.size() != check.plies){
+            cout << "FAILED " << check.text << ": " << (legal ? "legal" : game.error) << ", "
+                 << game.moves.size() << " plies\n";
+            failures++;
+        }
+    }
+    cout << sizeof(PGN_CASES) / sizeof(PGN_CASES[0]) - failures << "/" << sizeof(PGN_CASES) / sizeof(PGN_CASES[0])
+         << " PGN checks passed" << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// usage: pgn_import <file.pgn> [--threads N] [--record FILE]
+//        pgn_import --check
+// replays every game of a PGN file through the move rules on N threads(all cores by default),
+// reporting the byte offset of every game with an illegal or ambiguous move
+// --record also writes the legal games, in file order, to a binary game record file
+// --check replays the parser's built in regression cases instead
+int main(int argc, char *argv[]){
+    if (argc < 2){
+        cerr << "usage: pgn_import <file.pgn> [--threads N] [--record FILE]" << endl;
+        return 1;
+    }
+    if (strcmp(argv[1], "--check") == 0){
+        return run_checks();
+    }
+    int threads = max(int(thread::hardware_concurrency()), 1);
+    string recordFile;
+    for (int i = 2; i < argc; i++){
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            threads = max(stoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc){
+            recordFile = argv[++i];
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    unique_ptr<MappedFile> file;
+    try{
+        file.reset(new MappedFile(argv[1], true));
+    } catch (const runtime_error &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    const char *begin = file->chars();
+    const char *end = begin + file->file_size();
+    size_t chunkCount = (file->file_size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    vector<ChunkGames> chunks(recordFile.empty() ? 0 : chunkCount);
+    vector<ThreadTotals> totals(threads);
+    atomic<size_t> nextChunk{0};
+
+    // each thread takes the next chunk and replays every game starting inside it,
+    // reading past the end of the chunk to finish its last game
+    auto work = [&](int id){
+        Board board;
+        PgnGame game;
+        ThreadTotals &total = totals[id];
+        size_t chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunkCount){
+            const char *chunkBegin = begin + chunk * CHUNK_SIZE;
+            const char *chunkEnd = min(chunkBegin + CHUNK_SIZE, end);
+            const char *gameBegin = next_pgn_game(chunkBegin, begin, end);
+            while (gameBegin < chunkEnd){
+                const char *gameEnd = next_pgn_game(gameBegin + 1, begin, end);
+                total.games++;
+                if (!parse_pgn_game(gameBegin, gameEnd, board, game)){
+                    total.badGames.push_back({size_t(gameBegin - begin), game.error});
+                } else {
+                    total.plies += game.moves.size();
+                    if (!chunks.empty()){
+                        ChunkGames &out = chunks[chunk];
+                        out.moves.insert(out.moves.end(), game.moves.begin(), game.moves.end());
+                        out.fens.push_back(game.fen);
+                        out.results.push_back(game.result);
+                        out.plyCounts.push_back(uint16_t(min<size_t>(game.moves.size(), 0xFFFF)));
+                    }
+                }
+                gameBegin = gameEnd;
+            }
+        }
+    };
+    vector<thread> pool;
+    for (int id = 1; id < threads; id++){
+        pool.emplace_back(work, id);
+    }
+    work(0);
+    for (thread &worker: pool){
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t games = 0;
+    uint64_t plies = 0;
+    vector<BadGame> badGames;
+    for (const ThreadTotals &total: totals){
+        games += total.games;
+        plies += total.plies;
+        badGames.insert(badGames.end(), total.badGames.begin(), total.badGames.end());
+    }
+    sort(badGames.begin(), badGames.end(), [](const BadGame &a, const BadGame &b){
+        return a.offset < b.offset;
+    });
+    for (const BadGame &bad: badGames){
+        cout << "offset " << bad.offset << ": " << bad.error << "\n";
+    }
+    cout << games << " games, " << games - badGames.size() << " legal, " << badGames.size() << " bad, "
+         << plies << " plies\n" << file->file_size() / 1e6 << " MB in " << seconds << "s  "
+         << file->file_size() / 1e6 / max(seconds, 1e-9) << " MB/s  " << uint64_t(games / max(seconds, 1e-9))
+         << " games/s  " << uint64_t(plies / max(seconds, 1e-9)) << " plies/s on " << threads << " threads" << endl;
+
+    if (!recordFile.empty()){
+        try{
+            GameRecordWriter writer(recordFile);
+            for (const ChunkGames &chunk: chunks){
+                size_t move = 0;
+                for (size_t i = 0; i < chunk.fens.size(); i++){
+                    writer.begin_game(chunk.fens[i]);
+                    for (int ply = 0; ply < chunk.plyCounts[i]; ply++){
+                        writer.add_move(chunk.moves[move + ply]);
+                    }
+                    move += chunk.plyCounts[i];
+                    writer.end_game(chunk.results[i]);
+                }
+            }
+            writer.close();
+            cout << "recorded " << writer.game_count() << " games to " << recordFile << endl;
+        } catch (const exception &error){
+            cerr << error.what() << endl;
+            return 1;
+        }
+    }
+    return badGames.empty() ? 0 : 2;
+}
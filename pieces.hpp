@@ -1,265 +1,208 @@
 #ifndef PIECES_HPP
 #define PIECES_HPP
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
 #include <utility>
-#include <vector>
+#include "board.hpp"
 
 enum State{alive, dead};
 
-// Base class for a chess piece that the actual pieces in chess will be derived from
+// a chess piece stored by value as its type, team and square
+// movement rules are chosen with a switch on the type instead of a virtual call
+// so a set of pieces is a small array with no heap allocations
 class Piece{
-    int xPos;
-    int yPos;
-    State existence;
-    char symbol;
+    // square of the piece(x * 8 + y) or -1 once it has been taken
+    int8_t square;
+    uint8_t type;
+    uint8_t team;
+    uint8_t existence;
 
     public:
     Piece()
-        : xPos{0}, yPos{0}, existence{alive}, symbol{'*'}  {}
+        : square{-1}, type{noPiece}, team{nobody}, existence{dead} {}
+
+    Piece(PieceType type, TileOwner team, int x, int y)
+        : square(x * 8 + y), type(type), team(team), existence{alive} {}
 
     // bool to indicate if its possible for a piece of this type to move to in such
     // a manner ex.rooks can only move straight and knights can only move in L-shape
-    // virtual as each piece has different constraints on how it should move so 
-    // every piece class should define their own
-    virtual bool update_pos_possible(int x, int y)const = 0;
+    bool update_pos_possible(int x, int y) const{
+        // pawns, knights and kings look the squares they reach up in the attack tables
+        if (unsigned(x) > 7 || unsigned(y) > 7 || square < 0){
+            return false;
+        }
+        Bitboard target = square_bb(make_square(x, y));
+        int xDiff = x - square_x(square);
+        int yDiff = y - square_y(square);
+        switch (type){
+            case pawn:
+                // pawns only move forward, which is towards row 0 for white and row 7 for red
+                // by 1 space straight or diagnol, or by 2 spaces straight from their starting row
+                return (pawn_attacks(team, square) | pawn_pushes(team, square)) & target;
+            case rook:
+                // moves in a straight line
+                return (xDiff == 0) != (yDiff == 0);
+            case knight:
+                // moves in L-shape
+                return knight_attacks(square) & target;
+            case bishop:
+                // moves diagnolly
+                return xDiff != 0 && abs(xDiff) == abs(yDiff);
+            case queen:
+                // moves straight or diagnolly
+                return (xDiff != 0 || yDiff != 0) && (xDiff == 0 || yDiff == 0 || abs(xDiff) == abs(yDiff));
+            case king:
+                // only moves 1 space in any direction
+                return king_attacks(square) & target;
+            default:
+                return false;
+        }
+    }
 
     // updates position of piece
     void update_pos(int x, int y){
-        xPos = x;
-        yPos = y;
+        square = x * 8 + y;
     }
     
     // return x,y pair of position
+    // taken pieces are off the board at -10,-10
     const std::pair<int, int> return_pos() const{
-        return std::make_pair(xPos, yPos);
+        if (square < 0){
+            return std::make_pair(-10, -10);
+        }
+        return std::make_pair(square_x(square), square_y(square));
     }
 
-    // update what symbol represents piece
-    void update_symbol(char symb){
-        symbol = symb;
+    // changes the type of piece, used when a pawn is upgraded
+    void update_type(PieceType newType){
+        type = newType;
     }
 
     // Returns symbol representing piece
     char return_symbol() const{
-        return symbol;
+        return PIECE_SYMBOLS[type];
+    }
+
+    PieceType return_type() const{
+        return PieceType(type);
+    }
+
+    TileOwner return_team() const{
+        return TileOwner(team);
     }
 
     // update existence piece attributes when it's taken
     void piece_taken(){
         existence = dead;
-        update_symbol('*');
-        update_pos(-10, -10);
+        type = noPiece;
+        square = -1;
     }
     
     // Return state(if piece has been taken or not yet)
     State return_state() const{
-        return existence;
-    }
-};
-
-
-class Pawn: public Piece{
-    // pawn class must have team attribute because it is only piece
-    // that can't move backwards so must know which "side" owns it
-    const std::string team;
-    public:
-    // makes sure pawn is moving forward or diagnol by 1 space
-    bool update_pos_possible(int x, int y)const override{
-        const std::pair<int, int> pos = return_pos();
-        int xDiff = x - pos.first;
-        int yDiff = y - pos.second;
-        if (team == "white"){
-            if (xDiff >= 0){
-                return false;
-            } else if (xDiff < -1 || abs(yDiff) > 1){
-                if (pos.first == 6 && xDiff == -2 && yDiff == 0){
-                    return true;
-                }
-                return false;
-            }
-            return true;
-        } else {
-            if (xDiff <= 0){
-                return false;
-            } else if (xDiff > 1 || abs(yDiff) > 1){
-                if (pos.first == 1 && xDiff == 2 && yDiff == 0){
-                    return true;
-                }
-                return false;
-            }
-            return true;
-        }
-    }
-
-    Pawn(std::string team, int x, int y)
-        : team(team) {
-        update_pos(x, y);
-        update_symbol('P');
+        return State(existence);
     }
-    
 };
 
 
-class Rook: public Piece{
-    public:
-    // makes sure rook moves in a straight line
-    bool update_pos_possible(int x, int y)const override{
-        std::pair<int, int> pos = return_pos();
-        int xDiff = x - pos.first;
-        int yDiff = y - pos.second;
-        if (abs(xDiff) > 0 && abs(yDiff) > 0){
-            return false;
-        } else if (xDiff == 0 && yDiff == 0){
-            return false;
+// Combines piece types to form a set of pieces for a player
+class PieceSet{
+    Piece pieces[16];
+    // index into pieces of the piece of the set standing on each square(x * 8 + y) or -1
+    // kept in sync by update_pos, piece_taken and upgrade_piece so position lookups are a single load
+    int8_t squares[64];
+    // index into pieces of the king
+    int8_t kingIndex;
+
+    // fills squares from the positions of the pieces
+    void index_squares(){
+        for (int square = 0; square < 64; square++){
+            squares[square] = -1;
         }
-        return true;
-    }
-
-    Rook(int x, int y){
-        update_pos(x, y);
-        update_symbol('R');
-    }
-};
-
-
-class Knight: public Piece{
-    public:
-    // makes sure that knight moves in L-shape
-    bool update_pos_possible(int x, int y)const override{
-        std::pair<int, int> pos = return_pos();
-        int xDiff = x - pos.first;
-        int yDiff = y - pos.second;
-        if ((abs(xDiff) == 2 && abs(yDiff) == 1) || ((abs(yDiff) == 2 && abs(xDiff) == 1))) {
-            return true;
+        for (int i = 0; i < 16; i++){
+            if (pieces[i].return_state() == alive){
+                std::pair<int, int> pos = pieces[i].return_pos();
+                squares[square_index(pos.first, pos.second)] = i;
+            }
         }
-        return false;
     }
-    // given symbol 'N' because king has symbol 'K'
-    Knight(int x, int y){
-        update_pos(x, y);
-        update_symbol('N');
-    }
-};
 
-
-class Bishop: public Piece{
-    public:
-    // makes sure bishop moves diagnolly
-    bool update_pos_possible(int x, int y)const override{
-        std::pair<int, int> pos = return_pos();
-        int xDiff = x - pos.first;
-        int yDiff = y - pos.second;
-        if (abs(xDiff) != 0 && abs(xDiff) == abs(yDiff)){
-            return true;
+    // returns index into squares of a position or -1 if the position is off the board
+    static int square_index(int x, int y){
+        if (x < 0 || x > 7 || y < 0 || y > 7){
+            return -1;
         }
-        return false;
-    }
-    Bishop(int x, int y){
-        update_pos(x, y);
-        update_symbol('B');
+        return x * 8 + y;
     }
-};
-
 
-class Queen: public Piece{
     public:
-    // makes sure that queen moves straight or diagnolly
-    bool update_pos_possible(int x, int y)const override{
-        std::pair<int, int> pos = return_pos();
-        int xDiff = x - pos.first;
-        int yDiff = y - pos.second;
 
-        if ((abs(xDiff) != 0 && abs(yDiff) != 0) && abs(xDiff) != abs(yDiff)){
-            return false;
-        } else if (xDiff == 0 && yDiff == 0){
-            return false;
+    // upgrades pawn
+    // used when a player's pawn reaches the other side of board
+    void upgrade_piece(Piece *upgrade, char choice){
+        if (choice == 'Q' || choice == 'q'){
+            upgrade->update_type(queen);
+        } else if (choice == 'R' || choice == 'r'){
+            upgrade->update_type(rook);
+        } else if (choice == 'B' || choice == 'b'){
+            upgrade->update_type(bishop);
+        } else{
+            upgrade->update_type(knight);
         }
-        return true;
-    }
-    Queen(int x, int y){
-        update_pos(x, y);
-        update_symbol('Q');
     }
-};
-
 
-class King: public Piece{
-    public:
-    // makes sure that king only moves 1 space in any direction
-    bool update_pos_possible(int x, int y)const override{
-        std::pair<int, int> pos = return_pos();
-        int xDiff = x - pos.first;
-        int yDiff = y - pos.second;
-        
-        if (abs(xDiff) > 1 || abs(yDiff) > 1){
-            return false;
-        } else if (xDiff == 0 && yDiff == 0){
-            return false;
+    // moves a piece of the set to a new position
+    // throws std::invalid_argument if the piece has been taken or the position is off the board
+    void update_pos(Piece *piece, int x, int y){
+        std::pair<int, int> pos = piece->return_pos();
+        int from = square_index(pos.first, pos.second);
+        int to = square_index(x, y);
+        if (from < 0 || to < 0){
+            throw std::invalid_argument("only a piece on the board can move, and only to a square on the board");
         }
-        return true;
-    }
-    King(int x, int y){
-        update_pos(x, y);
-        update_symbol('K');
-    }
-};
-
-
-// Combines piece types to form a standard set of pieces for a player
-class PieceSet{
-    std::vector<Piece *> pieces;
-
-    public:
-
-    // upgrades pawn
-    // used when a player's pawn reaches the other side of board
-    void upgrade_piece(Piece *upgrade, char choice, std::pair<int, int> pos){
-        for (auto &piece: pieces){
-            if (piece == upgrade){
-                delete piece;
-                if (choice == 'Q' || choice == 'q'){
-                    piece = new Queen(pos.first, pos.second);
-                } else if (choice == 'R' || choice == 'r'){
-                    piece = new Rook(pos.first, pos.second);
-                } else if (choice == 'B' || choice == 'b'){
-                    piece = new Bishop(pos.first, pos.second);
-                } else{
-                    piece = new Knight(pos.first, pos.second);
-                }
-                break;
-            }
+        squares[to] = squares[from];
+        squares[from] = -1;
+        piece->update_pos(x, y);
+    }
+
+    // marks a piece of the set as taken and removes it from the board
+    // a piece already taken stays taken
+    void piece_taken(Piece *piece){
+        std::pair<int, int> pos = piece->return_pos();
+        int square = square_index(pos.first, pos.second);
+        if (square >= 0){
+            squares[square] = -1;
         }
+        piece->piece_taken();
     }
 
     // returns whether any piece from the set is located at the specified position
     bool piece_at_pos(int x, int y) const{
-        for (auto piece: pieces){
-            if (std::make_pair(x,y) == piece->return_pos()){
-                if (piece->return_state() == alive){
-                    return true;
-                }
-            }
-        }
-        return false;
+        int index = square_index(x, y);
+        return index >= 0 && squares[index] >= 0;
     }
 
     // returns pointer to piece in set if any piece at specified location
     // null pointer returned if no piece at position
-    Piece *return_piece_at_pos(int x, int y) const{
-        for (auto piece: pieces){
-            if (std::make_pair(x,y) == piece->return_pos()){
-                if (piece->return_state() == alive){
-                    return piece;
-                }
-            }
-        }
-        return nullptr;
+    Piece *return_piece_at_pos(int x, int y){
+        int index = square_index(x, y);
+        return (index < 0 || squares[index] < 0) ? nullptr : &pieces[squares[index]];
+    }
+
+    // return pointer of piece located at specified index in pieces array
+    // indexes 0-15 cover every piece of the set, taken pieces included
+    Piece *return_piece(size_t index){
+        return &pieces[index];
+    }
+
+    const Piece *return_piece(size_t index) const{
+        return &pieces[index];
     }
 
-    // return pointer of piece located at specified index in pieces vector
-    // used mainly to speed up other functions because pieces are at certain indexes
-    // for example can easily get pointer of king without looping through piece vector
-    Piece *return_piece(size_t index) const{
-        return pieces[index];
+    Piece *return_king(){
+        return &pieces[kingIndex];
     }
 
     // constructor of piece set that creates a set with the standard quantity
@@ -267,41 +210,36 @@ class PieceSet{
     // string passed in specifiy whether to make a set for "white" or "red" player
     // red equivalent to "black" in standard chess
     PieceSet(const std::string team){
-
-        pieces.reserve(16);
-        if (team == "red"){
-            for (size_t col = 0; col < 8; col++){
-                pieces.push_back(new Pawn(team, 1, col));
-            }
-            pieces.push_back(new Rook(0, 0));
-            pieces.push_back(new Knight(0, 1));
-            pieces.push_back(new Bishop(0, 2));
-            pieces.push_back(new Queen(0, 3));
-            pieces.push_back(new King(0, 4));
-            pieces.push_back(new Bishop(0, 5));
-            pieces.push_back(new Knight(0, 6));
-            pieces.push_back(new Rook(0, 7));
-        } else {
-            for (size_t col = 0; col < 8; col++){
-                pieces.push_back(new Pawn(team, 6, col));
-            }
-            pieces.push_back(new Rook(7, 0));
-            pieces.push_back(new Knight(7, 1));
-            pieces.push_back(new Bishop(7, 2));
-            pieces.push_back(new Queen(7, 3));
-            pieces.push_back(new King(7, 4));
-            pieces.push_back(new Bishop(7, 5));
-            pieces.push_back(new Knight(7, 6));
-            pieces.push_back(new Rook(7, 7));
+        TileOwner owner = team == "red" ? red : white;
+        int backRow = owner == red ? 0 : 7;
+        int pawnRow = owner == red ? 1 : 6;
+        const PieceType backRowTypes[8] = {rook, knight, bishop, queen, king, bishop, knight, rook};
+        for (int col = 0; col < 8; col++){
+            pieces[col] = Piece(pawn, owner, pawnRow, col);
+            pieces[8 + col] = Piece(backRowTypes[col], owner, backRow, col);
         }
+        kingIndex = 12;
+        index_squares();
     }
 
-    // Destructor which deletes all pieces in piece set which were allocated onto heap
-    // To avoid memory leaks
-    ~PieceSet(){
-        for (auto piece: pieces){
-            delete piece;
+    // constructor of piece set holding the pieces of a team in any position, ex. one read from FEN
+    // throws std::invalid_argument unless the team has one king and at most 16 pieces
+    PieceSet(const std::string team, const Board &board){
+        TileOwner owner = team == "red" ? red : white;
+        Bitboard teamPieces = board.pieces(owner);
+        if (pop_count(teamPieces) > 16 || pop_count(board.pieces(owner, king)) != 1){
+            throw std::invalid_argument("a " + team + " piece set needs one king and at most 16 pieces");
+        }
+        int count = 0;
+        while (teamPieces){
+            int square = pop_lsb(teamPieces);
+            PieceType type = board.type_at(square);
+            if (type == king){
+                kingIndex = count;
+            }
+            pieces[count++] = Piece(type, owner, square_x(square), square_y(square));
         }
+        index_squares();
     }
 };
 #endif
\ No newline at end of file
@@ -3,34 +3,89 @@
 
 #include <vector>
 #include <string>
+#include "move.hpp"
 #include "pieces.hpp"
 #include "board.hpp"
+#include "movegen.hpp"
+#include "instrument.hpp"
 
 
 // class representing a player
-// currently game only supports human players
-// but support for ai players can be added later 
-// and in that case this class will become a base class 
-// from which human and ai player classes will be derived from
+// moves are entered by a human at the terminal
+// computer players derive from this class and override move_piece
 class Player{
-    // each player has a set of pieces and a name
-    PieceSet pieces;
+    // each player has a set of pieces, a team and a name
+    const std::string team;
+    // the team as a board owner, worked out once so checks don't compare team names
+    const TileOwner owner;
     const std::string name;
 
+    // move played on the player's last turn, including the piece chosen for a pawn upgrade
+    Move lastMove = NULL_MOVE;
+
+    protected:
+    PieceSet pieces;
+
+    // plays a move on the board and updates both players' piece sets to match,
+    // including the rook of a castling move, a pawn taken en passant and promotions
+    void apply_move(Board &board, Player &other, Move move){
+        int from = move_from(move);
+        int to = move_to(move);
+        int flags = move_flags(move);
+        Piece *piece = pieces.return_piece_at_pos(square_x(from), square_y(from));
+        // a pawn taken en passant stands beside the pawn taking it
+        int captureSquare = flags == enPassant ? make_square(square_x(from), square_y(to)) : to;
+        Piece *captured = other.pieces.return_piece_at_pos(square_x(captureSquare), square_y(captureSquare));
+        if (captured){
+            other.pieces.piece_taken(captured);
+        }
+        pieces.update_pos(piece, square_x(to), square_y(to));
+        if (is_promotion(move)){
+            pieces.upgrade_piece(piece, PIECE_SYMBOLS[promotion_type(move)]);
+        }
+        if (flags == kingCastle || flags == queenCastle){
+            int rookFrom = flags == kingCastle ? to + 1 : to - 2;
+            int rookTo = flags == kingCastle ? to - 1 : to + 1;
+            pieces.update_pos(pieces.return_piece_at_pos(square_x(rookFrom), square_y(rookFrom)),
+                square_x(rookTo), square_y(rookTo));
+        }
+        board.play_move(move);
+        lastMove = move;
+    }
+
     public:
     Player(const std::string &team, const std::string &name)
-        : pieces{PieceSet(team)}, name{name} {}
+        : team{team}, owner{team == "red" ? red : white}, name{name}, pieces{PieceSet(team)} {}
+
+    virtual ~Player(){}
     
     const std::string return_name() const{
         return name;
     }
 
+    Move return_last_move() const{
+        return lastMove;
+    }
+
+    // returns a summary of how the last move was chosen to show after it is played,
+    // or why no move was played when move_piece fails
+    // empty for human players
+    virtual std::string return_last_move_info() const{
+        return "";
+    }
+
+    // sets up the player's pieces to match a position, ex. one read from FEN
+    // throws std::invalid_argument if the player's team doesn't have one king and at most 16 pieces
+    void set_position(const Board &board){
+        pieces = PieceSet(team, board);
+    }
+
     // checks if any of a players pawns have made it to other side of board
     // and are thus due for an upgrade
     // returns pointer to pawn due for uppgrade
     // if none due for upgrade returns nullptr
-    Piece *check_pawn_upgrade() const{
-        for (int i = 0; i < 8; i++){
+    Piece *check_pawn_upgrade(){
+        for (int i = 0; i < 16; i++){
             Piece *piece = pieces.return_piece(i);
             int xPos = piece->return_pos().first;
             if (piece->return_symbol() == 'P' && (xPos == 0 || xPos == 7)){
@@ -66,7 +121,9 @@ class Player{
                 std::cout << "Not a valid upgrade input. Try Again!\n";
                 continue;
             }
-            pieces.upgrade_piece(upgrade, choice, pos);
+            pieces.upgrade_piece(upgrade, choice);
+            int flags = (move_flags(lastMove) & captureMove) | knightPromotion | (symbol_to_type(choice) - knight);
+            lastMove = encode_move(move_from(lastMove), move_to(lastMove), flags);
             break;
         }
         
@@ -76,7 +133,8 @@ class Player{
     // simulates a chess move by a human player
     // prompts player for piece to move and where to move it to
     // and updates board and players' piece sets to reflect new piece position
-    void move_piece(Board &board, Player &other){
+    // returns false if the player had no move to play, which ends the game
+    virtual bool move_piece(Board &board, Player &other){
         int x = -1;
         int y = -1;
         Piece *pieceToMove = nullptr;
@@ -99,24 +157,32 @@ class Player{
             getline(std::cin, input);
             x = std::stoi(std::string(1, input[0]));
             y = std::stoi(std::string(1, input[2]));
-            if (!move_piece_possible(board, pieceToMove, other, x, y, true)){
+            bool possible;
+            {
+                TIME_PHASE(hot_path_counters().validationNanos);
+                possible = move_piece_possible(board, pieceToMove, other, x, y, true);
+            }
+            if (!possible){
                 std::cout << "Try again!\n";
                 continue;
             }
             break;
         }
         std::pair<int, int> currPos = pieceToMove->return_pos();
-        pieceToMove->update_pos(x, y);
+        pieces.update_pos(pieceToMove, x, y);
         Piece *opposingPiece = other.pieces.return_piece_at_pos(x, y);
         if (opposingPiece){
-            opposingPiece->piece_taken();
+            other.pieces.piece_taken(opposingPiece);
         }
-        board.update_board(x, y, currPos.first, currPos.second, pieceToMove->return_symbol());
+        lastMove = board.move_between(make_square(currPos.first, currPos.second), make_square(x, y));
+        board.update_board(x, y, currPos.first, currPos.second);
+        return true;
     }
 
     // return if it is possible for a player to move specified piece to the specified x y position
     // if not possible errorMsg bool specifies whether to print why to cout
-    bool move_piece_possible(Board &board, Piece *move, Player &other, int x, int y, bool errorMsg){
+    bool move_piece_possible(Board &board, const Piece *move, Player &other, int x, int y, bool errorMsg){
+        COUNT_CALL(movePiecePossible);
         if (!move){
             return false;
         }
@@ -146,288 +212,36 @@ class Player{
                 return false;
             } 
         }
-        // if opponent has piece at square then take it off board so it cause a false check error
-        Piece *pieceAtPos = other.pieces.return_piece_at_pos(x,y);
-        if (pieceAtPos){
-            pieceAtPos->update_pos(-10,-10);
-        }
-        // simulate board change if move completed and ensure that it does not cause a check
-        board.change_tile_symbol('*', move->return_pos().first, move->return_pos().second);
-        char currTileSymbol = board.return_symbol(x, y);
-        board.change_tile_symbol(move->return_symbol(), x, y);
-        std::pair<int, int> kingPos = pieces.return_piece(12)->return_pos();
-        int kingX = kingPos.first;
-        int kingY = kingPos.second;
-        if (move->return_symbol() == 'K'){
-            kingX = x;
-            kingY = y;
-        }
-        if (check(other, board, kingX, kingY)){
+        // the pins and checks of the position decide if the move leaves the king under check
+        int from = make_square(move->return_pos().first, move->return_pos().second);
+        Move boardMove = board.move_between(from, make_square(x, y));
+        if (!is_legal(board, boardMove, check_info(board))){
             // make sure move does not cause a check
             if(errorMsg){
                 std::cout << "Invalid! You are still under check or place yourself under check with this move";
             }
-            if (pieceAtPos){
-                pieceAtPos->update_pos(x, y);
-            }
-            // set board back to what it was origianlly
-            board.change_tile_symbol(move->return_symbol(), move->return_pos().first, move->return_pos().second);
-            board.change_tile_symbol(currTileSymbol, x, y);
             return false;
         }
-        // place opponents piece back at position as "check for check" is complete
-        if (pieceAtPos){
-            pieceAtPos->update_pos(x, y);
-        }
-        // set board back to what it was originally
-        board.change_tile_symbol(move->return_symbol(), move->return_pos().first, move->return_pos().second);
-        board.change_tile_symbol(currTileSymbol, x, y);
         return true; 
     }
 
     // returns if a player is under check
     bool check(const Player &other, Board &board, int kingX, int kingY){
-        for (size_t i = 0; i < 16; i++){
-            // loop through opponents pieces and see if they can move to king position
-            Piece *piece = other.pieces.return_piece(i);
-            if (piece->update_pos_possible(kingX, kingY) && !other.piece_in_way(*this, board, piece, kingX, kingY)
-                && piece->return_state() == alive){
-                return true;
-            }
-        }
-        return false;
+        COUNT_CALL(check);
+        return board.square_attacked(make_square(kingX, kingY), other.owner);
     }
 
-    // Returns a vector of piece pointers that contains the opponents pieces that are threatening your king
-    // Used in checkmate function to help determine if player can escape checkmate
-    std::vector<Piece *> pieces_threatening_king(const Player &other, Board &board, int kingX, int kingY){
-        std::vector<Piece *> threateningPieces;
-        for (size_t i = 0; i < 16; i++){
-            // loop through opponents pieces and see if they can take your king
-            Piece *piece = other.pieces.return_piece(i);
-            if (piece->update_pos_possible(kingX, kingY) && !other.piece_in_way(*this, board, piece, kingX, kingY)
-                && piece->return_state() == alive){
-                threateningPieces.push_back(piece);
-            }
-        }
-        return threateningPieces;
-    }
-    
     // returns if a player is checkmated(game over)
+    // under check with no legal move, found from the checkers and pins of the position
     bool check_mate(Player &other, Board &board){
-        Piece *king = pieces.return_piece(12);
-        std::pair<int, int> kingPos = king->return_pos();
-        int kingX = kingPos.first;
-        int kingY = kingPos.second;
-
-        // can't be checkmated if not under check already
-        if (check(other, board, kingX, kingY)){
-            // first check if you can move king to escape check
-            if (move_piece_possible(board, king, other, kingX - 1, kingY - 1, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX - 1, kingY, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX - 1, kingY + 1, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX, kingY - 1, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX, kingY + 1, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX + 1, kingY - 1, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX + 1, kingY, false)){
-                return false;
-            } else if (move_piece_possible(board, king, other, kingX + 1, kingY + 1, false)){
-                return false;
-            }
-
-            // next check if player can move one of other pieces to escape check
-            std::vector<Piece *> threateningPieces = pieces_threatening_king(other, board, kingX, kingY);
-            // if cant move king to escape check and king threatened by more than 1 piece then checkmate
-            if (threateningPieces.size() > 1){
-                return true;
-            } else {
-                // see if player can move one of its pieces to kill piece threatening king
-                std::pair<int, int> threateningPiecePos = threateningPieces[0]->return_pos();
-                int threateningX = threateningPiecePos.first;
-                int threateningY = threateningPiecePos.second;
-                for (size_t i = 0; i < 16; i++){
-                    Piece *piece = pieces.return_piece(i);
-                    if (piece->return_state() == dead){
-                        continue;
-                    }
-                    if (move_piece_possible(board, piece, other, threateningX, threateningY, false)){
-                        return false;
-                    }
-                }
-                // check if player can move one of its pieces to block threatening piece
-                char typeThreateningPiece = threateningPieces[0]->return_symbol();
-                // pawn or knight impossible to block
-                if (typeThreateningPiece == 'P' || typeThreateningPiece == 'N'){
-                    return true;
-                } else if (typeThreateningPiece == 'R'){
-                    // check if rook threatening king can be blocked
-                    for (size_t i = 0; i < 16; i++){
-                        Piece *piece = pieces.return_piece(i);
-                        if (piece->return_state() == dead){
-                            continue;
-                        }
-                        if (piece_block_row_check(board, piece, other, kingX, kingY, threateningX, threateningY)){
-                            return false;
-                        }
-                    }
-                    return true;
-                } else if (typeThreateningPiece == 'B'){
-                    for (size_t i = 0; i < 16; i++){
-                        // check if bishop threatening king can be blocked
-                        Piece *piece = pieces.return_piece(i);
-                        if (piece->return_state() == dead){
-                            continue;
-                        }
-                        if (piece_block_diagnol_check(board, piece, other, kingX, kingY, threateningX, threateningY)){
-                            return false;
-                        }
-                    }
-                    return true;
-                } else {
-                    // opponent queen: can move diagnol or straight so two control levels
-                    int xDiff = kingX - threateningX;
-                    int yDiff = kingY - threateningY;
-                    if (xDiff == 0 || yDiff == 0 ){
-                        // check if queen threatening king with straight move can be blocked
-                        for (size_t i = 0; i < 16; i++){
-                            Piece *piece = pieces.return_piece(i);
-                            if (piece->return_state() == dead){
-                                continue;
-                            }
-                            if (piece_block_row_check(board, piece, other, kingX, kingY, threateningX, threateningY)){
-                                return false;
-                            }
-                        }
-                        return true;
-                    } else {
-                        // check if queen threatening king with diagnol move can be blocked
-                        for (size_t i = 0; i < 16; i++){
-                            Piece *piece = pieces.return_piece(i);
-                            if (piece->return_state() == dead){
-                                continue;
-                            }
-                            if (piece_block_diagnol_check(board, piece, other, kingX, kingY, threateningX, threateningY)){
-                                return false;
-                            }
-                        }
-                        return true;
-                    }
-                }
-            }
-        } else{
-            // should not reach here but if checkmate not proven yet then assumed no checkmate
-            return false;
-        }
-    }
-
-    // returns if specified piece can move to a square to block a piece threatening king in same row as king
-    bool piece_block_row_check(Board &board, Piece *move, Player &other, int kingX, int kingY, int threatX, int threatY){
-        int xDiff = kingX - threatX;
-        int yDiff = kingY - threatY;
-
-        // 4 control flow statements for if threatening piece is in front of king, behind king,
-        // to the left of king, or to the right of king
-        if (xDiff > 0) {
-            threatX++;
-            while (threatX != kingX){
-                if (move_piece_possible(board, move, other, threatX, threatY, false)){
-                    return true;
-                }
-                threatX++;
-            }
-            return false;
-        } else if (xDiff < 0){
-            threatX--;
-            while (threatX != kingX){
-                if (move_piece_possible(board, move, other, threatX, threatY, false)){
-                    return true;
-                }
-                threatX--;
-            }
-            return false;
-        } else if (yDiff > 0){
-            threatY++;
-            while (threatY != kingY){
-                if (move_piece_possible(board, move, other, threatX, threatY, false)){
-                    return true;
-                }
-                threatY++;
-            }
-            return false;
-        } else {
-            threatY--;
-            while (threatY != kingY){
-                if (move_piece_possible(board, move, other, threatX, threatY, false)){
-                    return true;
-                }
-                threatY--;
-            }
-            return false;
-        }
+        COUNT_CALL(checkMate);
+        std::pair<int, int> kingPos = pieces.return_king()->return_pos();
+        return check(other, board, kingPos.first, kingPos.second) && !has_legal_move(board);
     }
 
-    // returns if specified piece can move to a square to block a piece threatening king diagnoly
-    bool piece_block_diagnol_check(Board &board, Piece *move, Player &other, int kingX, int kingY, int threatX, int threatY){
-        int xDiff = kingX - threatX;
-        int yDiff = kingY - threatY;
-
-        // 4 control flow statements for if threatening piece is in front left of king, front right,
-        // back left, or back right
-        if (xDiff > 0 && yDiff > 0){
-            threatX++;
-            threatY++;
-            while (threatX != kingX){
-                if (move_piece_possible(board, move, other, threatX, threatY, false )){
-                    return true;
-                }
-                threatX++;
-                threatY++;
-            }
-            return false;
-        } else if (xDiff > 0 && yDiff < 0){
-            threatX++;
-            threatY--;
-            while (threatX != kingX){
-                if (move_piece_possible(board, move, other, threatX, threatY, false )){
-                    return true;
-                }
-                threatX++;
-                threatY--;
-            }
-            return false;
-        } else if (xDiff < 0 && yDiff < 0){
-            threatX--;
-            threatY--;
-            while (threatX != kingX){
-                if (move_piece_possible(board, move, other, threatX, threatY, false )){
-                    return true;
-                }
-                threatX--;
-                threatY--;
-            }
-            return false;
-        } else {
-            threatX--;
-            threatY++;
-            while (threatX != kingX){
-                if (move_piece_possible(board, move, other, threatX, threatY, false )){
-                    return true;
-                }
-                threatX--;
-                threatY++;
-            }
-            return false;
-        }
-    }
-    
     // returns if there is a piece blocking a desired move path for a piece
-    bool piece_in_way(const Player &other, const Board &board, Piece *move, int x, int y) const{
+    bool piece_in_way(const Player &other, const Board &board, const Piece *move, int x, int y) const{
+        COUNT_CALL(pieceInWay);
         std::pair<int,int> currPos = move->return_pos();
         int currX = currPos.first;
         int currY = currPos.second;
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "game_record.hpp"
+#include "board.hpp"
+using namespace std;
+
+// usage: record_stats <file> [--replay]
+// reads every game of a binary game record file and prints corpus statistics with the read speed
+// --replay also plays every move on a board, counting captures, promotions, castles and checks
+int main(int argc, char *argv[]){
+    if (argc < 2){
+        cerr << "usage: record_stats <file> [--replay]" << endl;
+        return 1;
+    }
+    bool replay = argc > 2 && strcmp(argv[2], "--replay") == 0;
+    auto start = chrono::steady_clock::now();
+    try{
+        GameRecordReader reader(argv[1]);
+        uint64_t results[4] = {0, 0, 0, 0};
+        uint64_t plies = 0;
+        uint64_t longest = 0;
+        uint64_t fenStarts = 0;
+        uint64_t captures = 0;
+        uint64_t promotions = 0;
+        uint64_t castles = 0;
+        uint64_t checks = 0;
+        const string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+        Board board;
+        for (uint64_t i = 0; i < reader.game_count(); i++){
+            RecordedGame game = reader.game(i);
+            int gamePlies = game.ply_count();
+            results[game.result() & 3]++;
+            plies += gamePlies;
+            longest = max<uint64_t>(longest, gamePlies);
+            fenStarts += !game.standard_start();
+            if (!replay){
+                continue;
+            }
+            board.set_fen(game.standard_start() ? START_FEN : game.start_fen());
+            for (int ply = 0; ply < gamePlies; ply++){
+                Move move = game.move(ply);
+                captures += is_capture(move);
+                promotions += is_promotion(move);
+                castles += move_flags(move) == kingCastle || move_flags(move) == queenCastle;
+                board.play_move(move);
+                checks += board.in_check();
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << reader.game_count() << " games, " << plies << " plies, " << reader.file_size() << " bytes ("
+             << double(reader.file_size()) / max<uint64_t>(plies, 1) << " bytes/ply)\n"
+             << "white wins " << results[whiteWinResult] << ", red wins " << results[redWinResult]
+             << ", draws " << results[drawResult] << ", unfinished " << results[unfinishedResult] << "\n"
+             << "average length " << double(plies) / max<uint64_t>(reader.game_count(), 1) << " plies, longest "
+             << longest << ", " << fenStarts << " games from set up positions\n";
+        if (replay){
+            cout << "captures " << captures << ", promotions " << promotions << ", castles " << castles
+                 << ", checks " << checks << "\n";
+        }
+        cout << "read in " << seconds << "s  " << uint64_t(reader.game_count() / max(seconds, 1e-9)) << " games/s  "
+             << uint64_t(plies / max(seconds, 1e-9)) << " plies/s" << endl;
+    } catch (const exception &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef REPLAY_PLAYER_HPP
+#define REPLAY_PLAYER_HPP
+#include <string>
+#include <vector>
+#include "player.hpp"
+#include "movegen.hpp"
+
+// player that plays its moves of a recorded game, ex. "e2e4" or "e7e8q", without any prompts
+// both players of a game share the move list and the index of the next move to play
+class ReplayPlayer: public Player{
+    const std::vector<std::string> &moves;
+    size_t &next;
+    std::string error;
+
+    public:
+    ReplayPlayer(const std::string &team, const std::string &name, const std::vector<std::string> &moves, size_t &next)
+        : Player(team, name), moves(moves), next(next) {}
+
+    // plays the next recorded move if it is legal
+    // fails at the end of the move list or on a move that isn't legal in the position
+    bool move_piece(Board &board, Player &other) override{
+        if (next >= moves.size()){
+            error = "end of move list";
+            return false;
+        }
+        std::string text = moves[next];
+        for (char &c: text){
+            c = char(tolower(c));
+        }
+        MoveList legalMoves;
+        generate_legal_moves(board, legalMoves);
+        for (Move move: legalMoves){
+            if (move_to_string(move) == text){
+                apply_move(board, other, move);
+                next++;
+                return true;
+            }
+        }
+        error = "illegal move " + moves[next] + " at ply " + std::to_string(next + 1);
+        return false;
+    }
+
+    std::string return_last_move_info() const override{
+        return error;
+    }
+};
+
+#endif
@@ -0,0 +1,612 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "board.hpp"
+#include "movegen.hpp"
+#include "tt.hpp"
+#include "tablebase.hpp"
+#include "nnue.hpp"
+
+// deepest ply the search can reach including quiescence and check extensions
+const int MAX_PLY = 128;
+const int INFINITE_SCORE = 32001;
+// score of being checkmated at the root, mates further away score closer to zero
+const int MATE_SCORE = 32000;
+// scores beyond this are mates
+const int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+// value in centipawns of each piece type, indexed by PieceType
+const int PIECE_VALUES[7] = {100, 320, 330, 500, 900, 0, 0};
+
+// blends a midgame and an endgame score by the game phase, which can pass MAX_PHASE after promotions
+inline int taper(int midgame, int endgame, int phase){
+    phase = std::min(phase, MAX_PHASE);
+    return (midgame * phase + endgame * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
+// returns the material and piece-square score of the position in centipawns from the point of view
+// of the team to move, from the sums the board keeps up to date with every move
+inline int evaluate(const Board &board){
+    int score = taper(board.midgame_score(), board.endgame_score(), board.game_phase());
+    return board.side_to_move() == white ? score : -score;
+}
+
+// returns the same score as evaluate by adding up every piece on the board
+// kept to check and benchmark the incremental sums against
+inline int evaluate_from_scratch(const Board &board){
+    int midgame = 0;
+    int endgame = 0;
+    int phase = 0;
+    for (int square = 0; square < 64; square++){
+        TileOwner owner = board.owner_at(square);
+        if (owner != nobody){
+            PieceType type = board.type_at(square);
+            midgame += PIECE_SQUARE_SCORES.midgame[owner][type][square];
+            endgame += PIECE_SQUARE_SCORES.endgame[owner][type][square];
+            phase += PHASE_WEIGHTS[type];
+        }
+    }
+    int score = taper(midgame, endgame, phase);
+    return board.side_to_move() == white ? score : -score;
+}
+
+// how long a search may run, zero meaning no limit
+struct SearchLimits{
+    int depth = MAX_PLY - 1;
+    // milliseconds
+    int64_t moveTime = 0;
+};
+
+// progress of the search reported after every completed depth
+struct SearchInfo{
+    int depth;
+    int score;
+    uint64_t nodes;
+    double seconds;
+    std::vector<Move> pv;
+};
+
+// outcome of a search
+struct SearchResult{
+    Move bestMove = NULL_MOVE;
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+
+// mate scores count plies from the root but a table entry can be reached at any ply,
+// so they are stored counting from the entry's own position instead
+inline int score_to_tt(int score, int ply){
+    return score >= MATE_BOUND ? score + ply : (score <= -MATE_BOUND ? score - ply : score);
+}
+
+inline int score_from_tt(int score, int ply){
+    return score >= MATE_BOUND ? score - ply : (score <= -MATE_BOUND ? score + ply : score);
+}
+
+// returns the score of a position at a ply from its tablebase byte
+inline int tablebase_score(uint8_t value, int ply){
+    if (value == 0){
+        return 0;
+    }
+    int plies = value - 1;
+    return plies % 2 ? MATE_SCORE - ply - plies : -MATE_SCORE + ply + plies;
+}
+
+// state every thread of one search shares
+struct SharedSearchState{
+    TranspositionTable tt;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start;
+    // set when the time runs out, the main thread finishes or a stop is requested from another thread
+    std::atomic<bool> stop{false};
+    // endgame tables, which outlive the search, or nullptr for none
+    const TablebaseSet *tablebases = nullptr;
+    // network evaluating positions in place of evaluate, which outlives the search, or nullptr for none
+    const NnueNetwork *network = nullptr;
+
+    double elapsed_seconds() const{
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// one thread of the search with its own copy of the board and move ordering tables
+// iterative deepening principal variation search with quiescence search
+// each depth is searched with a full window for the first move and null windows for the rest,
+// re-searching when a null window search shows a move might be better
+// moves are tried in order: transposition table move, captures by most valuable victim and
+// least valuable attacker, killer moves, then quiet moves by history score
+class SearchWorker{
+    SharedSearchState &shared;
+    const int id;
+    Board board;
+    bool stopped;
+    // only written by this thread, read by the main thread to total the nodes of all threads
+    std::atomic<uint64_t> nodes;
+    // hash keys of the game positions before the root followed by the positions of the current path
+    std::vector<uint64_t> keys;
+    // principal variation collected at each ply
+    Move pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    // quiet moves that caused a beta cutoff at each ply
+    Move killers[MAX_PLY][2];
+    // how often each quiet move(by team, from and to square) caused a beta cutoff, weighted by depth
+    int historyScores[2][64][64];
+    // network accumulators of the positions on the current path, by ply, when a network is used
+    NnueAccumulator accumulators[MAX_PLY + 1];
+
+    // sets stopped when another thread ends the search or, on the main thread, when the time runs out
+    // only checks every 2048 nodes as reading the clock is far slower than searching a node
+    void check_stop(){
+        uint64_t count = nodes.load(std::memory_order_relaxed) + 1;
+        nodes.store(count, std::memory_order_relaxed);
+        if ((count & 2047) == 0){
+            if (id == 0 && shared.limits.moveTime > 0 && shared.elapsed_seconds() * 1000 >= shared.limits.moveTime){
+                shared.stop.store(true, std::memory_order_relaxed);
+            }
+            if (shared.stop.load(std::memory_order_relaxed)){
+                stopped = true;
+            }
+        }
+    }
+
+    // returns if the current position is drawn by the fifty move rule or repeats an earlier position
+    // only positions since the last capture or pawn move, with the same team to move, can repeat
+    bool is_draw() const{
+        if (board.halfmove_clock() >= 100){
+            return true;
+        }
+        int current = int(keys.size()) - 1;
+        int oldest = std::max(0, current - board.halfmove_clock());
+        for (int i = current - 2; i >= oldest; i -= 2){
+            if (keys[i] == keys[current]){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // gives every move a score, higher scores are searched first
+    void score_moves(const MoveList &moves, int scores[], int ply, Move hashMove) const{
+        TileOwner us = board.side_to_move();
+        for (int i = 0; i < moves.size(); i++){
+            Move move = moves[i];
+            if (move == hashMove){
+                scores[i] = 1000000;
+            } else if (is_capture(move) || is_promotion(move)){
+                int victim = move_flags(move) == enPassant ? pawn : board.type_at(move_to(move));
+                int attacker = board.type_at(move_from(move));
+                scores[i] = 100000 + (victim == noPiece ? 0 : PIECE_VALUES[victim] * 10) - attacker
+                    + (is_promotion(move) ? PIECE_VALUES[promotion_type(move)] : 0);
+            } else if (move == killers[ply][0]){
+                scores[i] = 90000;
+            } else if (move == killers[ply][1]){
+                scores[i] = 89000;
+            } else {
+                scores[i] = historyScores[us][move_from(move)][move_to(move)];
+            }
+        }
+    }
+
+    // moves the highest scoring move from index on to index
+    static void pick_move(MoveList &moves, int scores[], int index){
+        int best = index;
+        for (int i = index + 1; i < moves.size(); i++){
+            if (scores[i] > scores[best]){
+                best = i;
+            }
+        }
+        std::swap(moves.begin()[index], moves.begin()[best]);
+        std::swap(scores[index], scores[best]);
+    }
+
+    // returns the evaluation of the position at a ply, from the network if the search has one
+    int static_evaluation(int ply) const{
+        return shared.network ? shared.network->evaluate(accumulators[ply], board.side_to_move()) : evaluate(board);
+    }
+
+    // makes a move from the position at a ply, bringing the next ply's network accumulator up to date
+    void make_move(Move move, int ply){
+        if (shared.network){
+            shared.network->update(board, move, accumulators[ply], accumulators[ply + 1]);
+        }
+        board.make_move(move);
+    }
+
+    // searches only captures and promotions until the position is quiet so that
+    // the evaluation is never taken in the middle of an exchange
+    // when under check every move is searched as standing pat isn't an option
+    int quiescence(int alpha, int beta, int ply){
+        check_stop();
+        if (stopped){
+            return 0;
+        }
+        if (ply >= MAX_PLY - 1){
+            return static_evaluation(ply);
+        }
+        TileOwner us = board.side_to_move();
+        TileOwner them = TileOwner(us ^ 1);
+        bool inCheck = board.in_check();
+        int bestScore = -INFINITE_SCORE;
+        if (!inCheck){
+            bestScore = static_evaluation(ply);
+            if (bestScore >= beta){
+                return bestScore;
+            }
+            alpha = std::max(alpha, bestScore);
+        }
+
+        MoveList moves;
+        generate_pseudo_legal_moves(board, moves);
+        int scores[256];
+        score_moves(moves, scores, ply, NULL_MOVE);
+        int legal = 0;
+        for (int i = 0; i < moves.size(); i++){
+            pick_move(moves, scores, i);
+            Move move = moves[i];
+            if (!inCheck && !is_capture(move) && !is_promotion(move)){
+                continue;
+            }
+            make_move(move, ply);
+            if (board.square_attacked(board.king_square(us), them)){
+                board.unmake_move(move);
+                continue;
+            }
+            legal++;
+            int score = -quiescence(-beta, -alpha, ply + 1);
+            board.unmake_move(move);
+            if (stopped){
+                return 0;
+            }
+            if (score > bestScore){
+                bestScore = score;
+                if (score > alpha){
+                    alpha = score;
+                    if (score >= beta){
+                        break;
+                    }
+                }
+            }
+        }
+        if (inCheck && legal == 0){
+            return -MATE_SCORE + ply;
+        }
+        return bestScore;
+    }
+
+    // principal variation search of the current position to the specified depth
+    // returns the score from the point of view of the team to move
+    int alpha_beta(int depth, int alpha, int beta, int ply, bool nullAllowed){
+        pvLength[ply] = ply;
+        if (ply > 0 && is_draw()){
+            return 0;
+        }
+        // positions the endgame tables cover are known exactly
+        uint8_t tablebaseValue;
+        if (ply > 0 && shared.tablebases && shared.tablebases->probe(board, tablebaseValue)){
+            return tablebase_score(tablebaseValue, ply);
+        }
+        TileOwner us = board.side_to_move();
+        TileOwner them = TileOwner(us ^ 1);
+        bool inCheck = board.in_check();
+        // look one move deeper when under check so forced sequences aren't cut short
+        if (inCheck){
+            depth++;
+        }
+        if (depth <= 0){
+            return quiescence(alpha, beta, ply);
+        }
+        if (ply >= MAX_PLY - 1){
+            return static_evaluation(ply);
+        }
+        check_stop();
+        if (stopped){
+            return 0;
+        }
+        bool pvNode = beta - alpha > 1;
+        int originalAlpha = alpha;
+
+        // a deep enough result from this or another thread ends the search of this position
+        // except on the principal variation, which is always searched so it can be reported whole
+        TTEntry entry;
+        Move hashMove = NULL_MOVE;
+        if (shared.tt.probe(board.hash_key(), entry)){
+            hashMove = entry.move;
+            int score = score_from_tt(entry.score, ply);
+            if (!pvNode && ply > 0 && entry.depth >= depth
+                && (entry.bound == exactBound
+                    || (entry.bound == lowerBound && score >= beta)
+                    || (entry.bound == upperBound && score <= alpha))){
+                return score;
+            }
+        }
+
+        // null move pruning: if passing still fails high a real move would too
+        // skipped with only pawns left as zugzwang is common there
+        Bitboard bigPieces = board.pieces(us) & ~board.pieces(us, pawn) & ~board.pieces(us, king);
+        if (nullAllowed && !pvNode && !inCheck && depth >= 3 && bigPieces && static_evaluation(ply) >= beta){
+            if (shared.network){
+                accumulators[ply + 1] = accumulators[ply];
+            }
+            board.make_null_move();
+            keys.push_back(board.hash_key());
+            int score = -alpha_beta(depth - 3, -beta, -beta + 1, ply + 1, false);
+            keys.pop_back();
+            board.unmake_null_move();
+            if (stopped){
+                return 0;
+            }
+            if (score >= beta && score < MATE_BOUND){
+                return score;
+            }
+        }
+
+        MoveList moves;
+        generate_pseudo_legal_moves(board, moves);
+        int scores[256];
+        score_moves(moves, scores, ply, hashMove);
+
+        int bestScore = -INFINITE_SCORE;
+        Move bestMove = NULL_MOVE;
+        int legal = 0;
+        for (int i = 0; i < moves.size(); i++){
+            pick_move(moves, scores, i);
+            Move move = moves[i];
+            make_move(move, ply);
+            if (board.square_attacked(board.king_square(us), them)){
+                board.unmake_move(move);
+                continue;
+            }
+            legal++;
+            keys.push_back(board.hash_key());
+            bool quiet = !is_capture(move) && !is_promotion(move);
+            int score;
+            if (legal == 1){
+                score = -alpha_beta(depth - 1, -beta, -alpha, ply + 1, true);
+            } else {
+                // late quiet moves are first searched one ply shallower
+                int reduction = (depth >= 3 && legal > 4 && quiet && !inCheck && !board.in_check()) ? 1 : 0;
+                score = -alpha_beta(depth - 1 - reduction, -alpha - 1, -alpha, ply + 1, true);
+                if (score > alpha && reduction){
+                    score = -alpha_beta(depth - 1, -alpha - 1, -alpha, ply + 1, true);
+                }
+                if (score > alpha && score < beta){
+                    score = -alpha_beta(depth - 1, -beta, -alpha, ply + 1, true);
+                }
+            }
+            keys.pop_back();
+            board.unmake_move(move);
+            if (stopped){
+                return 0;
+            }
+
+            if (score > bestScore){
+                bestScore = score;
+                if (score > alpha){
+                    alpha = score;
+                    bestMove = move;
+                    pvTable[ply][ply] = move;
+                    for (int next = ply + 1; next < pvLength[ply + 1]; next++){
+                        pvTable[ply][next] = pvTable[ply + 1][next];
+                    }
+                    pvLength[ply] = pvLength[ply + 1];
+                    if (score >= beta){
+                        if (quiet){
+                            if (killers[ply][0] != move){
+                                killers[ply][1] = killers[ply][0];
+                                killers[ply][0] = move;
+                            }
+                            historyScores[us][move_from(move)][move_to(move)] += depth * depth;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+        if (legal == 0){
+            // checkmate or stalemate
+            return inCheck ? -MATE_SCORE + ply : 0;
+        }
+        Bound bound = bestScore >= beta ? lowerBound : (alpha > originalAlpha ? exactBound : upperBound);
+        shared.tt.store(board.hash_key(), bestMove, score_to_tt(bestScore, ply), depth, bound);
+        return bestScore;
+    }
+
+    public:
+    SearchWorker(SharedSearchState &shared, int id)
+        : shared(shared), id{id}, stopped{false}, nodes{0} {}
+
+    uint64_t node_count() const{
+        return nodes.load(std::memory_order_relaxed);
+    }
+
+    // searches root with iterative deepening until the depth limit or until the search is stopped
+    // the main thread(id 0) searches every depth and reports each one it completes
+    // helper threads skip depths in a staggered pattern so the threads spread over different depths,
+    // sharing what they find only through the transposition table
+    SearchResult iterate(const Board &root, const std::vector<uint64_t> &gameKeys, Move firstMove,
+                         const std::function<void(const SearchInfo &)> &onDepth){
+        static const int SKIP_SIZE[16] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4};
+        static const int SKIP_PHASE[16] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3};
+        board = root;
+        if (shared.network){
+            shared.network->refresh(board, accumulators[0]);
+        }
+        stopped = false;
+        nodes = 0;
+        keys = gameKeys;
+        keys.push_back(board.hash_key());
+        std::memset(killers, 0, sizeof(killers));
+        std::memset(historyScores, 0, sizeof(historyScores));
+
+        SearchResult result;
+        result.bestMove = firstMove;
+        for (int depth = 1; depth <= shared.limits.depth; depth++){
+            if (id > 0){
+                int helper = (id - 1) % 16;
+                if (((depth + SKIP_PHASE[helper]) / SKIP_SIZE[helper]) % 2 != 0){
+                    continue;
+                }
+            }
+            int score = alpha_beta(depth, -INFINITE_SCORE, INFINITE_SCORE, 0, false);
+            // an unfinished depth is thrown away, the previous depth's move is kept
+            if (stopped){
+                break;
+            }
+            result.bestMove = pvTable[0][0];
+            result.score = score;
+            result.depth = depth;
+            if (id != 0){
+                continue;
+            }
+            if (onDepth){
+                onDepth({depth, score, 0, shared.elapsed_seconds(), std::vector<Move>(pvTable[0], pvTable[0] + pvLength[0])});
+            }
+            // a forced mate has been found, or the next depth is unlikely to finish in time
+            if (std::abs(score) >= MATE_BOUND
+                || (shared.limits.moveTime > 0 && shared.elapsed_seconds() * 1000 * 2 >= shared.limits.moveTime)){
+                break;
+            }
+        }
+        return result;
+    }
+};
+
+// lazy SMP search: every thread searches the same root position, the helper threads at staggered
+// depths, and they cooperate only by sharing one lockless transposition table
+// the main thread decides when the search ends and its result is the one played
+class Search{
+    SharedSearchState shared;
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+    std::function<void(const SearchInfo &)> onDepth;
+
+    uint64_t total_nodes() const{
+        uint64_t total = 0;
+        for (const auto &worker: workers){
+            total += worker->node_count();
+        }
+        return total;
+    }
+
+    public:
+    explicit Search(int threads = 1){
+        set_threads(threads);
+    }
+
+    // number of threads searching, at least one
+    void set_threads(int threads){
+        workers.clear();
+        for (int id = 0; id < std::max(threads, 1); id++){
+            workers.emplace_back(new SearchWorker(shared, id));
+        }
+    }
+
+    int thread_count() const{
+        return int(workers.size());
+    }
+
+    // size of the transposition table in megabytes, clears it
+    void set_hash_size(size_t megabytes){
+        shared.tt.resize(megabytes);
+    }
+
+    // forgets every position searched so far, ex. before starting a new game
+    void clear_hash(){
+        shared.tt.clear();
+    }
+
+    // sets the endgame tables to probe, which must outlive the search, or nullptr for none
+    void set_tablebases(const TablebaseSet *tablebases){
+        shared.tablebases = tablebases;
+    }
+
+    // sets the network to evaluate positions with, which must outlive the search,
+    // or nullptr for the piece-square evaluation
+    void set_network(const NnueNetwork *network){
+        shared.network = network;
+    }
+
+    // sets a function called with the search progress after every completed depth
+    void set_info_callback(std::function<void(const SearchInfo &)> callback){
+        onDepth = callback;
+    }
+
+    // ends a running search as soon as possible, safe to call from another thread
+    void stop(){
+        shared.stop = true;
+    }
+
+    // readies the search for the next think, called on the thread that may later call stop and before the
+    // search starts so a stop arriving before think runs isn't lost
+    void prepare(){
+        shared.stop = false;
+    }
+
+    // searches a position for the best move within the limits, prepare must be called first
+    // gameKeys holds the hash keys of the positions played before it, used to spot repetitions
+    // returns NULL_MOVE as best move only if the team to move has no legal move
+    SearchResult think(const Board &root, const SearchLimits &limits, const std::vector<uint64_t> &gameKeys = {}){
+        shared.limits = limits;
+        shared.start = std::chrono::steady_clock::now();
+        shared.tt.new_search();
+
+        SearchResult result;
+        MoveList rootMoves;
+        Board board = root;
+        generate_legal_moves(board, rootMoves);
+        if (rootMoves.size() == 0){
+            return result;
+        }
+        if (rootMoves.size() == 1){
+            shared.limits.depth = 1;
+        }
+        // completed depths are reported with the node count of every thread
+        auto report = [this](const SearchInfo &info){
+            if (onDepth){
+                SearchInfo total = info;
+                total.nodes = total_nodes();
+                onDepth(total);
+            }
+        };
+
+        std::vector<std::thread> helpers;
+        for (size_t id = 1; id < workers.size(); id++){
+            SearchWorker *worker = workers[id].get();
+            helpers.emplace_back([worker, &root, &gameKeys, &rootMoves](){
+                worker->iterate(root, gameKeys, rootMoves[0], nullptr);
+            });
+        }
+        result = workers[0]->iterate(root, gameKeys, rootMoves[0], report);
+        shared.stop = true;
+        for (std::thread &helper: helpers){
+            helper.join();
+        }
+        result.nodes = total_nodes();
+        result.seconds = shared.elapsed_seconds();
+        return result;
+    }
+};
+
+// returns a score as text, in pawns or as the number of moves to mate
+inline std::string score_to_string(int score){
+    if (std::abs(score) >= MATE_BOUND){
+        int moves = (MATE_SCORE - std::abs(score) + 1) / 2;
+        return std::string(score > 0 ? "mate in " : "mated in ") + std::to_string(moves);
+    }
+    std::string sign = score < 0 ? "-" : "+";
+    int value = std::abs(score);
+    std::string hundredths = std::to_string(value % 100);
+    return sign + std::to_string(value / 100) + "." + (hundredths.size() == 1 ? "0" : "") + hundredths;
+}
+
+#endif
@@ -0,0 +1,437 @@
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include "game.hpp"
+#include "line_socket.hpp"
+using namespace std;
+
+// player of a game hosted by the server, playing the moves its client sends
+// the server checks a move is legal before handing it over, so playing it can't fail
+class RemotePlayer: public Player{
+    Move pending = NULL_MOVE;
+
+    public:
+    using Player::Player;
+
+    void set_move(Move move){
+        pending = move;
+    }
+
+    bool move_piece(Board &board, Player &other) override{
+        if (pending == NULL_MOVE){
+            return false;
+        }
+        apply_move(board, other, pending);
+        pending = NULL_MOVE;
+        return true;
+    }
+};
+
+struct Session;
+
+// a client connected to the server
+// only the event loop thread the client was accepted on reads from it and changes its session,
+// but any thread may send it a line, so sending and closing take the lock
+struct Connection{
+    int fd;
+    // epoll instance of the thread the connection belongs to
+    int epoll;
+    string input;
+    shared_ptr<Session> session;
+    int seat = 0;
+
+    mutex lock;
+    string output;
+    bool closed = false;
+    bool waitingToWrite = false;
+
+    Connection(int fd, int epoll)
+        : fd{fd}, epoll{epoll} {}
+
+    // writes as much of the output as the socket takes, asking the event loop to be told when it
+    // takes more if some is left, and closes the connection on an error
+    // must be called holding the lock
+    void flush(){
+        while (!output.empty()){
+            ssize_t sent = ::send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR){
+                continue;
+            }
+            if (sent < 0 && errno != EAGAIN){
+                output.clear();
+                shutdown(fd, SHUT_RDWR);
+                return;
+            }
+            if (sent < 0){
+                break;
+            }
+            output.erase(0, sent);
+        }
+        bool waiting = !output.empty();
+        if (waiting != waitingToWrite){
+            epoll_event event{};
+            event.events = EPOLLIN | (waiting ? uint32_t(EPOLLOUT) : 0u);
+            event.data.ptr = this;
+            epoll_ctl(epoll, EPOLL_CTL_MOD, fd, &event);
+            waitingToWrite = waiting;
+        }
+    }
+
+    void send(const string &line){
+        lock_guard<mutex> guard(lock);
+        if (closed){
+            return;
+        }
+        output += line;
+        output += '\n';
+        flush();
+    }
+};
+
+// a game between the clients seated at it, white first
+// the lock guards the game and the seats, and is taken before any connection's lock
+struct Session{
+    int id;
+    unique_ptr<Game> game;
+    RemotePlayer *players[2];
+    shared_ptr<Connection> seats[2];
+    // set when the game ended early because a client left
+    bool abandoned = false;
+    mutex lock;
+
+    bool finished() const{
+        return abandoned || game->is_over();
+    }
+
+    string over_line() const{
+        return "over " + game->return_result().score + " " + game->return_result().reason;
+    }
+};
+
+// sessions shared by every event loop thread
+struct Server{
+    mutex lock;
+    // games waiting for a second player to join them
+    unordered_map<int, shared_ptr<Session>> openGames;
+    atomic<int> nextId{1};
+    atomic<uint64_t> connections{0};
+    atomic<uint64_t> games{0};
+    atomic<uint64_t> moves{0};
+};
+
+atomic<bool> stopRequested{false};
+
+void request_stop(int){
+    stopRequested = true;
+}
+
+// takes a client out of its game, which the other player wins if it was still being played,
+// and drops a game nobody joined
+void leave_session(Server &server, Connection &client){
+    shared_ptr<Session> session = move(client.session);
+    if (!session){
+        return;
+    }
+    lock_guard<mutex> guard(session->lock);
+    session->seats[client.seat].reset();
+    if (client.seat == 0 && !session->seats[1]){
+        lock_guard<mutex> openGuard(server.lock);
+        server.openGames.erase(session->id);
+    }
+    shared_ptr<Connection> other = session->seats[client.seat ^ 1];
+    if (!session->finished()){
+        session->abandoned = true;
+        if (other){
+            other->send(string("over ") + (client.seat == 0 ? "0-1" : "1-0") + " opponent left");
+        }
+    }
+}
+
+// line protocol, one command per line, answered in order
+//   new [fen <fen>]  start a game playing white         -> game <id> white
+//   join <id>        take red in a game waiting for it   -> game <id> red, and "joined <id>" to white
+//   move <move>      play a move like e2e4 or e7e8q      -> ok <move>, and "opponent <move>" to the other player
+//   fen              position of the game                -> fen <fen>
+//   ping                                                 -> pong
+//   quit             leave, the other player wins a game still being played
+// when a game ends both players get "over <score> <reason>", ex. "over 1-0 checkmate"
+// anything that can't be done is answered with "error <why>"
+// returns false when the client quits
+bool handle_line(Server &server, const shared_ptr<Connection> &client, const string &line){
+    istringstream words(line);
+    string command;
+    words >> command;
+    if (command == "new" || command == "join"){
+        if (client->session){
+            lock_guard<mutex> guard(client->session->lock);
+            if (!client->session->finished()){
+                client->send("error already playing a game");
+                return true;
+            }
+        }
+        leave_session(server, *client);
+    }
+
+    if (command == "new"){
+        string word;
+        string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+        if (words >> word && word == "fen"){
+            getline(words >> ws, fen);
+        }
+        shared_ptr<Session> session(new Session());
+        try{
+            session->players[0] = new RemotePlayer("white", "white");
+            session->players[1] = new RemotePlayer("red", "red");
+            session->game.reset(new Game(unique_ptr<Player>(session->players[0]), unique_ptr<Player>(session->players[1]), fen));
+        } catch (const invalid_argument &error){
+            client->send(string("error ") + error.what());
+            return true;
+        }
+        session->game->set_display(false);
+        session->game->start();
+        session->id = server.nextId++;
+        session->seats[0] = client;
+        client->session = session;
+        client->seat = 0;
+        {
+            lock_guard<mutex> guard(server.lock);
+            server.openGames[session->id] = session;
+        }
+        server.games++;
+        client->send("game " + to_string(session->id) + " white");
+    } else if (command == "join"){
+        int id = 0;
+        words >> id;
+        shared_ptr<Session> session;
+        {
+            lock_guard<mutex> guard(server.lock);
+            auto found = server.openGames.find(id);
+            if (found != server.openGames.end()){
+                session = found->second;
+                server.openGames.erase(found);
+            }
+        }
+        unique_lock<mutex> guard;
+        if (session){
+            guard = unique_lock<mutex>(session->lock);
+        }
+        // white may have left just as the game was found
+        if (!session || !session->seats[0]){
+            client->send("error no game " + to_string(id) + " waiting for a player");
+            return true;
+        }
+        session->seats[1] = client;
+        client->session = session;
+        client->seat = 1;
+        client->send("game " + to_string(id) + " red");
+        if (session->seats[0]){
+            session->seats[0]->send("joined " + to_string(id));
+        }
+        if (session->finished()){
+            // the game started from a position that is already over
+            client->send(session->over_line());
+            if (session->seats[0]){
+                session->seats[0]->send(session->over_line());
+            }
+        }
+    } else if (command == "move"){
+        string text;
+        words >> text;
+        if (!client->session){
+            client->send("error not playing a game");
+            return true;
+        }
+        Session &session = *client->session;
+        lock_guard<mutex> guard(session.lock);
+        const Board &board = session.game->return_board();
+        if (session.finished()){
+            client->send("error game over");
+            return true;
+        } else if (!session.seats[1]){
+            client->send("error waiting for an opponent");
+            return true;
+        } else if ((board.side_to_move() == white ? 0 : 1) != client->seat){
+            client->send("error not your turn");
+            return true;
+        }
+        Board position = board;
+        MoveList legalMoves;
+        generate_legal_moves(position, legalMoves);
+        Move chosen = NULL_MOVE;
+        for (Move move: legalMoves){
+            if (move_to_string(move) == text){
+                chosen = move;
+                break;
+            }
+        }
+        if (chosen == NULL_MOVE){
+            client->send("error illegal move " + text);
+            return true;
+        }
+        session.players[client->seat]->set_move(chosen);
+        session.game->play_turn();
+        server.moves++;
+        client->send("ok " + text);
+        shared_ptr<Connection> other = session.seats[client->seat ^ 1];
+        if (other){
+            other->send("opponent " + text);
+        }
+        if (session.finished()){
+            client->send(session.over_line());
+            if (other){
+                other->send(session.over_line());
+            }
+        }
+    } else if (command == "fen"){
+        if (!client->session){
+            client->send("error not playing a game");
+            return true;
+        }
+        lock_guard<mutex> guard(client->session->lock);
+        client->send("fen " + client->session->game->fen());
+    } else if (command == "ping"){
+        client->send("pong");
+    } else if (command == "quit"){
+        return false;
+    } else if (!command.empty()){
+        client->send("error unknown command " + command);
+    }
+    return true;
+}
+
+// event loop of one server thread, serving the clients it accepts until the server is stopped
+// every thread waits on the listening socket, and the kernel wakes one of them per new client
+void event_loop(Server &server, int listener){
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    // the thread's clients by the address epoll hands back
+    unordered_map<Connection *, shared_ptr<Connection>> clients;
+    auto disconnect = [&](Connection *client){
+        shared_ptr<Connection> owned = clients[client];
+        clients.erase(client);
+        {
+            lock_guard<mutex> guard(owned->lock);
+            owned->closed = true;
+            epoll_ctl(epoll, EPOLL_CTL_DEL, owned->fd, nullptr);
+            close(owned->fd);
+        }
+        leave_session(server, *owned);
+    };
+
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+    char buffer[65536];
+    while (!stopRequested){
+        int ready = epoll_wait(epoll, events, MAX_EVENTS, 200);
+        for (int i = 0; i < ready; i++){
+            if (!events[i].data.ptr){
+                while (true){
+                    int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0){
+                        break;
+                    }
+                    set_no_delay(fd);
+                    shared_ptr<Connection> client(new Connection(fd, epoll));
+                    epoll_event clientEvent{};
+                    clientEvent.events = EPOLLIN;
+                    clientEvent.data.ptr = client.get();
+                    clients[client.get()] = client;
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &clientEvent);
+                    server.connections++;
+                }
+                continue;
+            }
+            Connection *client = static_cast<Connection *>(events[i].data.ptr);
+            if (events[i].events & EPOLLOUT){
+                lock_guard<mutex> guard(client->lock);
+                client->flush();
+            }
+            if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))){
+                continue;
+            }
+            bool open = true;
+            ssize_t received = recv(client->fd, buffer, sizeof(buffer), 0);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)){
+                open = false;
+            } else if (received > 0){
+                client->input.append(buffer, received);
+                string line;
+                while (open && take_line(client->input, line)){
+                    open = handle_line(server, clients[client], line);
+                }
+                // a line this long isn't part of the protocol
+                open = open && client->input.size() <= 4096;
+            }
+            if (!open){
+                disconnect(client);
+            }
+        }
+    }
+    while (!clients.empty()){
+        disconnect(clients.begin()->first);
+    }
+    close(epoll);
+}
+
+// usage: server [--unix PATH | --port N [--host ADDRESS]] [--threads T]
+// hosts any number of games between clients connecting to a unix socket or a TCP port(default the
+// unix socket /tmp/chess.sock), served by T(default all cores) threads each running an epoll event loop
+// see handle_line for the protocol
+// runs until interrupted, then prints the number of clients, games and moves served
+int main(int argc, char *argv[]){
+    SocketAddress address;
+    address.unixPath = "/tmp/chess.sock";
+    int threads = max(1, int(thread::hardware_concurrency()));
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc){
+            address.unixPath = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc){
+            address.port = stoi(argv[++i]);
+            address.unixPath.clear();
+        } else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc){
+            address.host = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            threads = max(1, stoi(argv[++i]));
+        } else {
+            cerr << "unknown argument " << argv[i] << endl;
+            return 1;
+        }
+    }
+    int listener;
+    try{
+        listener = listen_socket(address);
+    } catch (const runtime_error &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    signal(SIGINT, request_stop);
+    signal(SIGTERM, request_stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    Server server;
+    cout << "listening on " << address.describe() << " with " << threads << " threads" << endl;
+    vector<thread> pool;
+    for (int id = 0; id < threads; id++){
+        pool.emplace_back(event_loop, ref(server), listener);
+    }
+    for (thread &loop: pool){
+        loop.join();
+    }
+    close(listener);
+    if (!address.unixPath.empty()){
+        unlink(address.unixPath.c_str());
+    }
+    cout << "\n" << server.connections << " clients, " << server.games << " games, " << server.moves << " moves" << endl;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "search.hpp"
+using namespace std;
+
+// middlegame and endgame positions searched to a fixed depth by every thread count
+const vector<string> POSITIONS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+// usage: smp_bench [depth] [max threads]
+// times the search of every position to the depth with 1, 2, 4, ... threads up to the maximum
+// and reports the time to depth speedup and nodes/sec of each thread count against one thread
+int main(int argc, char *argv[]){
+    int depth = argc > 1 ? stoi(argv[1]) : 9;
+    int maxThreads = argc > 2 ? stoi(argv[2]) : max(int(thread::hardware_concurrency()), 1);
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2){
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    SearchLimits limits;
+    limits.depth = depth;
+    cout << "depth " << depth << ", " << POSITIONS.size() << " positions\n";
+    printf("%8s %10s %14s %12s %9s %9s\n", "threads", "seconds", "nodes", "nodes/sec", "speedup", "nps x");
+    double baseSeconds = 0;
+    double baseNps = 0;
+    for (int threads: threadCounts){
+        Search search(threads);
+        search.set_hash_size(64);
+        double seconds = 0;
+        uint64_t nodes = 0;
+        for (const string &fen: POSITIONS){
+            // every position starts from an empty table so thread counts are compared fairly
+            search.clear_hash();
+            search.prepare();
+            SearchResult result = search.think(Board(fen), limits);
+            seconds += result.seconds;
+            nodes += result.nodes;
+        }
+        double nps = nodes / max(seconds, 1e-9);
+        if (threads == 1){
+            baseSeconds = seconds;
+            baseNps = nps;
+        }
+        printf("%8d %10.3f %14llu %12.0f %9.2f %9.2f\n", threads, seconds, (unsigned long long)nodes, nps,
+               baseSeconds / max(seconds, 1e-9), nps / max(baseNps, 1e-9));
+    }
+}
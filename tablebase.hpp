@@ -0,0 +1,446 @@
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include "mapped_file.hpp"
+#include "board.hpp"
+
+// endgame tablebases holding the exact outcome of every position of a small material set,
+// named by a material signature like "KQvK" or "KRvKP" with white's pieces before the v, built with tb_gen
+// pieces are listed in signature order: white's king, white's other pieces, red's king then red's others
+// a position is first turned by the board symmetries that don't change it: any of the 8 rotations and
+// mirrorings without pawns, which puts white's king in the a1-d1-d4 triangle, and the left-right mirror
+// with pawns, which puts it on the a-d files
+// its index then counts, most significant first, the team to move, the pair of king squares out of the
+// pairs with white's king in that region and the kings apart, and the square of each other piece among
+// the squares the pieces before it left free:
+//   index = ((team * king pairs + pair) * 62 + free square of piece 2) * 61 + free square of piece 3
+// a position the symmetries map onto more than one index, ex. white's king on the diagonal, uses the smallest
+// so a probe is one load from a memory mapped file
+// each index holds one byte, 0 for a draw or an index no position uses and otherwise
+// 1 + the plies to mate with perfect play, an odd number of plies meaning the team to move mates
+// and an even number that it gets mated
+// castling and en passant aren't part of the index, positions with either aren't probed
+
+// most pieces, kings included, of a table
+const int TB_MAX_PIECES = 4;
+// longest mate in plies a table byte can hold
+const int TB_MAX_PLIES = 252;
+const char TB_MAGIC[4] = {'C', 'T', 'B', '2'};
+// magic followed by the material signature padded with zeros
+const size_t TB_HEADER_SIZE = 16;
+// order the pieces of a team are listed in a signature, strongest first
+const char TB_PIECE_ORDER[] = "QRBNP";
+
+struct TablebasePiece{
+    TileOwner owner;
+    PieceType type;
+};
+
+// returns the pieces of a material signature in index order
+// throws std::invalid_argument unless it's a king per team followed by at most TB_MAX_PIECES pieces in all
+inline std::vector<TablebasePiece> tb_pieces(const std::string &signature){
+    size_t split = signature.find('v');
+    if (split == std::string::npos || signature.size() - 1 > size_t(TB_MAX_PIECES) || signature[0] != 'K'
+        || split + 1 >= signature.size() || signature[split + 1] != 'K'){
+        throw std::invalid_argument("invalid material signature: " + signature);
+    }
+    std::vector<TablebasePiece> order;
+    for (size_t i = 0; i < signature.size(); i++){
+        if (i == split){
+            continue;
+        }
+        PieceType type = symbol_to_type(signature[i]);
+        bool kingSlot = i == 0 || i == split + 1;
+        if (type == noPiece || !std::isupper(signature[i]) || (type == king) != kingSlot){
+            throw std::invalid_argument("invalid material signature: " + signature);
+        }
+        order.push_back({i < split ? white : red, type});
+    }
+    return order;
+}
+
+// returns the material signature of a position
+inline std::string tb_signature(const Board &board){
+    std::string signature;
+    for (int owner = white; owner <= red; owner++){
+        signature += owner == white ? "K" : "vK";
+        for (const char *symbol = TB_PIECE_ORDER; *symbol; symbol++){
+            int count = pop_count(board.pieces(TileOwner(owner), symbol_to_type(*symbol)));
+            signature.append(count, *symbol);
+        }
+    }
+    return signature;
+}
+
+// returns a signature with the teams swapped, ex. KRvKQ for KQvKR
+inline std::string tb_flipped(const std::string &signature){
+    size_t split = signature.find('v');
+    return signature.substr(split + 1) + "v" + signature.substr(0, split);
+}
+
+// returns the signature tables are generated under, the one with the stronger pieces on white's side
+// a position with the teams the other way round is probed with the board flipped
+inline std::string tb_canonical(const std::string &signature){
+    size_t split = signature.find('v');
+    std::string ours = signature.substr(1, split - 1);
+    std::string theirs = signature.substr(split + 2);
+    if (ours.size() != theirs.size()){
+        return ours.size() > theirs.size() ? signature : tb_flipped(signature);
+    }
+    for (size_t i = 0; i < ours.size(); i++){
+        const char *a = std::strchr(TB_PIECE_ORDER, ours[i]);
+        const char *b = std::strchr(TB_PIECE_ORDER, theirs[i]);
+        if (a != b){
+            return a < b ? signature : tb_flipped(signature);
+        }
+    }
+    return signature;
+}
+
+// index of a position no table holds, ex. one with the kings side by side
+const uint64_t TB_NO_INDEX = ~uint64_t(0);
+
+// returns a square turned by one of the 8 symmetries of the board:
+// bit 0 mirrors the columns, bit 1 the rows and bit 2 swaps rows and columns
+inline int tb_transform(int square, int symmetry){
+    int x = square_x(square) ^ (symmetry & 2 ? 7 : 0);
+    int y = square_y(square) ^ (symmetry & 1 ? 7 : 0);
+    return symmetry & 4 ? make_square(y, x) : make_square(x, y);
+}
+
+// the layout of the positions of one material set in its table, see the top of this file
+class TablebaseIndex{
+    std::vector<TablebasePiece> order;
+    // position in order of red's king
+    int redKing;
+    int symmetries;
+    // index of each pair of white and red king squares, or -1 for a pair with white's king outside
+    // its region or the kings on or next to each other
+    int16_t kingPairs[64][64];
+    std::vector<std::pair<int8_t, int8_t>> pairSquares;
+    uint64_t positions;
+
+    public:
+    // throws std::invalid_argument if the signature isn't a valid material set
+    explicit TablebaseIndex(const std::string &signature)
+        : order(tb_pieces(signature)){
+        bool pawns = false;
+        for (size_t i = 0; i < order.size(); i++){
+            pawns |= order[i].type == pawn;
+            if (order[i].owner == red && order[i].type == king){
+                redKing = int(i);
+            }
+        }
+        symmetries = pawns ? 2 : 8;
+        for (int whiteKing = 0; whiteKing < 64; whiteKing++){
+            int x = square_x(whiteKing);
+            int y = square_y(whiteKing);
+            // row 7 is white's back row
+            bool region = pawns ? y <= 3 : x >= 4 && y <= 3 && y >= 7 - x;
+            for (int redKingSquare = 0; redKingSquare < 64; redKingSquare++){
+                kingPairs[whiteKing][redKingSquare] = -1;
+                if (region && redKingSquare != whiteKing && !(king_attacks(whiteKing) & square_bb(redKingSquare))){
+                    kingPairs[whiteKing][redKingSquare] = int16_t(pairSquares.size());
+                    pairSquares.push_back({int8_t(whiteKing), int8_t(redKingSquare)});
+                }
+            }
+        }
+        positions = 2 * pairSquares.size();
+        for (size_t i = 2; i < order.size(); i++){
+            positions *= 64 - i;
+        }
+    }
+
+    const std::vector<TablebasePiece> &pieces() const{
+        return order;
+    }
+
+    // number of indexes of the table
+    uint64_t size() const{
+        return positions;
+    }
+
+    // returns the index of a position from the square of each piece in order and the team to move
+    // or TB_NO_INDEX if the kings are side by side or two pieces share a square
+    uint64_t encode(const int squares[], TileOwner side) const{
+        uint64_t best = TB_NO_INDEX;
+        for (int symmetry = 0; symmetry < symmetries; symmetry++){
+            int pair = kingPairs[tb_transform(squares[0], symmetry)][tb_transform(squares[redKing], symmetry)];
+            if (pair < 0){
+                continue;
+            }
+            int turned[TB_MAX_PIECES];
+            int count = 0;
+            for (size_t i = 0; i < order.size(); i++){
+                if (i == 0 || int(i) == redKing){
+                    continue;
+                }
+                turned[count] = tb_transform(squares[i], symmetry);
+                // pieces of the same type and team are listed from the lowest square up
+                if (count > 0 && order[i].type == order[i - 1].type && order[i].owner == order[i - 1].owner
+                    && turned[count] < turned[count - 1]){
+                    std::swap(turned[count], turned[count - 1]);
+                }
+                count++;
+            }
+            uint64_t index = uint64_t(side) * pairSquares.size() + pair;
+            Bitboard occupied = square_bb(pairSquares[pair].first) | square_bb(pairSquares[pair].second);
+            for (int i = 0; i < count; i++){
+                Bitboard square = square_bb(turned[i]);
+                if (occupied & square){
+                    return TB_NO_INDEX;
+                }
+                index = index * (62 - i) + turned[i] - pop_count(occupied & (square - 1));
+                occupied |= square;
+            }
+            best = std::min(best, index);
+        }
+        return best;
+    }
+
+    // fills the square of each piece in order and the team to move of an index
+    // a position that encodes to another index is one of the indexes no position uses
+    void decode(uint64_t index, int squares[], TileOwner &side) const{
+        int freeSquares[TB_MAX_PIECES];
+        int count = int(order.size()) - 2;
+        for (int i = count - 1; i >= 0; i--){
+            freeSquares[i] = int(index % (62 - i));
+            index /= 62 - i;
+        }
+        side = TileOwner(index / pairSquares.size());
+        const std::pair<int8_t, int8_t> &pair = pairSquares[index % pairSquares.size()];
+        Bitboard occupied = square_bb(pair.first) | square_bb(pair.second);
+        int other = 0;
+        for (size_t i = 0; i < order.size(); i++){
+            if (i == 0){
+                squares[i] = pair.first;
+            } else if (int(i) == redKing){
+                squares[i] = pair.second;
+            } else {
+                // the free square counted by the index
+                Bitboard empty = ~occupied;
+                for (int skip = freeSquares[other++]; skip > 0; skip--){
+                    empty &= empty - 1;
+                }
+                squares[i] = lsb(empty);
+                occupied |= square_bb(squares[i]);
+            }
+        }
+    }
+
+    // returns the index of a position on a board with this table's material
+    // flipped looks at the board upside down with the teams swapped, for a table of the flipped signature
+    uint64_t index(const Board &board, bool flipped) const{
+        Bitboard remaining[2][6];
+        for (int owner = white; owner <= red; owner++){
+            for (int type = pawn; type <= king; type++){
+                remaining[owner][type] = board.pieces(TileOwner(owner), PieceType(type));
+            }
+        }
+        int squares[TB_MAX_PIECES];
+        for (size_t i = 0; i < order.size(); i++){
+            int square = pop_lsb(remaining[order[i].owner ^ flipped][order[i].type]);
+            squares[i] = flipped ? square ^ 56 : square;
+        }
+        return encode(squares, TileOwner(board.side_to_move() ^ flipped));
+    }
+};
+
+// number of material sets told apart by tb_material_slot
+const int TB_MATERIAL_SLOTS = 11 * 11;
+
+// returns the slot of a material set by the kinds(team * 5 + type) of its two pieces besides the kings,
+// 10 standing for no piece, smaller kind first, or -1 if there are more
+inline int tb_material_slot(int first, int second){
+    return first < second ? first * 11 + second : second * 11 + first;
+}
+
+inline int tb_material_slot(const std::vector<TablebasePiece> &order){
+    int kinds[2] = {10, 10};
+    int count = 0;
+    for (const TablebasePiece &piece: order){
+        if (piece.type != king){
+            if (count == 2){
+                return -1;
+            }
+            kinds[count++] = piece.owner * 5 + piece.type;
+        }
+    }
+    return tb_material_slot(kinds[0], kinds[1]);
+}
+
+inline int tb_material_slot(const Board &board){
+    Bitboard others = board.occupancy() & ~board.pieces(king);
+    int kinds[2] = {10, 10};
+    for (int count = 0; others; count++){
+        if (count == 2){
+            return -1;
+        }
+        int square = pop_lsb(others);
+        kinds[count] = board.owner_at(square) * 5 + board.type_at(square);
+    }
+    return tb_material_slot(kinds[0], kinds[1]);
+}
+
+// one table, read from a memory mapped file or held in memory by its generator
+class Tablebase{
+    std::string signature;
+    TablebaseIndex layout;
+    std::unique_ptr<MappedFile> file;
+    const uint8_t *values;
+
+    // returns the signature stored in the header of a table file
+    // throws std::runtime_error if the file isn't a tablebase file
+    static std::string read_signature(const MappedFile &file, const std::string &path){
+        const uint8_t *bytes = file.bytes();
+        if (file.file_size() < TB_HEADER_SIZE || std::memcmp(bytes, TB_MAGIC, sizeof(TB_MAGIC)) != 0){
+            throw std::runtime_error(path + " is not a tablebase file");
+        }
+        const char *name = reinterpret_cast<const char *>(bytes) + sizeof(TB_MAGIC);
+        std::string signature(name, strnlen(name, TB_HEADER_SIZE - sizeof(TB_MAGIC)));
+        try{
+            tb_pieces(signature);
+        } catch (const std::invalid_argument &error){
+            throw std::runtime_error(path + ": " + error.what());
+        }
+        return signature;
+    }
+
+    public:
+    // maps a table file
+    // throws std::runtime_error if the file can't be mapped or isn't a whole table
+    explicit Tablebase(const std::string &path)
+        : Tablebase(std::unique_ptr<MappedFile>(new MappedFile(path)), path) {}
+
+    // table held in memory, values must outlive it
+    Tablebase(const std::string &signature, const uint8_t *values)
+        : signature(signature), layout(signature), values(values) {}
+
+    const std::string &material() const{
+        return signature;
+    }
+
+    const TablebaseIndex &index() const{
+        return layout;
+    }
+
+    uint8_t value(uint64_t index) const{
+        return values[index];
+    }
+
+    private:
+    Tablebase(std::unique_ptr<MappedFile> mapped, const std::string &path)
+        : signature(read_signature(*mapped, path)), layout(signature), file(std::move(mapped)){
+        if (file->file_size() != TB_HEADER_SIZE + layout.size()){
+            throw std::runtime_error(path + " is truncated");
+        }
+        values = file->bytes() + TB_HEADER_SIZE;
+    }
+};
+
+// every table available to a search, looked up by the material of a position
+class TablebaseSet{
+    struct Slot{
+        const Tablebase *table = nullptr;
+        // the table is of the flipped material and the board is probed upside down
+        bool flipped = false;
+    };
+
+    std::vector<std::unique_ptr<Tablebase>> tables;
+    // table of each material slot, filled when tables are added so a probe never builds a signature
+    Slot slots[TB_MATERIAL_SLOTS];
+
+    void index_slots(){
+        for (Slot &slot: slots){
+            slot = Slot();
+        }
+        for (const std::unique_ptr<Tablebase> &table: tables){
+            slots[tb_material_slot(table->index().pieces())] = {table.get(), false};
+        }
+        for (const std::unique_ptr<Tablebase> &table: tables){
+            Slot &slot = slots[tb_material_slot(tb_pieces(tb_flipped(table->material())))];
+            if (!slot.table){
+                slot = {table.get(), true};
+            }
+        }
+    }
+
+    public:
+    // maps every .tb file of a directory and returns how many were found
+    // throws std::runtime_error if the directory or one of the files can't be read
+    size_t load_directory(const std::string &directory){
+        DIR *dir = opendir(directory.c_str());
+        if (!dir){
+            throw std::runtime_error("can't open " + directory);
+        }
+        size_t found = 0;
+        try{
+            while (dirent *entry = readdir(dir)){
+                std::string name = entry->d_name;
+                if (name.size() > 3 && name.compare(name.size() - 3, 3, ".tb") == 0){
+                    add(std::unique_ptr<Tablebase>(new Tablebase(directory + "/" + name)));
+                    found++;
+                }
+            }
+        } catch (...){
+            closedir(dir);
+            throw;
+        }
+        closedir(dir);
+        return found;
+    }
+
+    // adds a table, replacing any table of the same material
+    void add(std::unique_ptr<Tablebase> table){
+        bool replaced = false;
+        for (std::unique_ptr<Tablebase> &existing: tables){
+            if (existing->material() == table->material()){
+                existing = std::move(table);
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced){
+            tables.push_back(std::move(table));
+        }
+        index_slots();
+    }
+
+    bool contains(const std::string &signature) const{
+        const Slot &slot = slots[tb_material_slot(tb_pieces(signature))];
+        return slot.table && !slot.flipped;
+    }
+
+    size_t size() const{
+        return tables.size();
+    }
+
+    // looks up the table byte of a position, see the top of this file for its meaning
+    // returns false if no table covers the material or the position has castling rights or an en passant square
+    // a lone king against a lone king is always a draw and needs no table
+    bool probe(const Board &board, uint8_t &value) const{
+        if (pop_count(board.occupancy()) > TB_MAX_PIECES || board.castling_rights() != 0
+            || board.en_passant_square() != NO_SQUARE){
+            return false;
+        }
+        if (pop_count(board.occupancy()) == 2){
+            value = 0;
+            return true;
+        }
+        const Slot &slot = slots[tb_material_slot(board)];
+        if (!slot.table){
+            return false;
+        }
+        value = slot.table->value(slot.table->index().index(board, slot.flipped));
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "movegen.hpp"
+#include "tablebase.hpp"
+using namespace std;
+
+// states of a position during generation besides the plies to mate of a decided one
+const uint8_t UNKNOWN = 255;
+const uint8_t IMPOSSIBLE = 254;
+const uint8_t DRAWN = 253;
+
+// runs work(thread, first, last) on threads over equal parts of [0, count)
+template <typename Work>
+void parallel_for(int threads, uint64_t count, Work work){
+    vector<thread> pool;
+    uint64_t part = (count + threads - 1) / threads;
+    for (int id = 0; id < threads; id++){
+        uint64_t first = min(count, id * part);
+        uint64_t last = min(count, first + part);
+        pool.emplace_back(work, id, first, last);
+    }
+    for (thread &worker: pool){
+        worker.join();
+    }
+}
+
+// retrograde analysis of one material set
+// every legal position is first given its moves: mates and stalemates are decided straight away,
+// captures and promotions lead into smaller or already built tables and are looked up, and the moves
+// staying inside the table are counted
+// then, ply by ply from the mates, the positions decided at one ply are unmoved: a position that can move
+// into a lost one is won a ply later, and a position whose moves all lead into won positions is lost
+// once its count of undecided moves reaches zero
+// moves are counted by the distinct indexes they lead to, as two moves of a position the board symmetries
+// map onto each other lead into one index and get unmoved once
+// each ply is split over the threads, positions being decided with compare and swap
+class TablebaseGenerator{
+    const TablebaseSet &tables;
+    string signature;
+    TablebaseIndex layout;
+    vector<TablebasePiece> order;
+    int count;
+    uint64_t size;
+    int threads;
+    // plies to mate of each decided position, or one of the states above
+    unique_ptr<atomic<uint8_t>[]> plies;
+    // moves inside the table not yet known to lead to a won position, one more if a capture or promotion
+    // wins or draws
+    unique_ptr<atomic<uint8_t>[]> remaining;
+    // fewest plies a loss can take, set by captures and promotions into won positions
+    unique_ptr<uint8_t[]> lossFloor;
+    // positions to decide at a later ply, wins through captures and promotions and losses held back by lossFloor
+    vector<vector<uint32_t>> pending;
+    mutex pendingLock;
+
+    // returns if a position can happen: no two pieces on one square, no pawn on a back row and
+    // the team that just moved not left in check
+    bool possible(const int squares[], TileOwner side) const{
+        Bitboard occupied = 0;
+        for (int i = 0; i < count; i++){
+            if ((occupied & square_bb(squares[i]))
+                || (order[i].type == pawn && (square_x(squares[i]) == 0 || square_x(squares[i]) == 7))){
+                return false;
+            }
+            occupied |= square_bb(squares[i]);
+        }
+        int kingSquare = 0;
+        for (int i = 0; i < count; i++){
+            if (order[i].owner != side && order[i].type == king){
+                kingSquare = squares[i];
+            }
+        }
+        for (int i = 0; i < count; i++){
+            if (order[i].owner != side){
+                continue;
+            }
+            Bitboard attacks = 0;
+            switch (order[i].type){
+                case pawn: attacks = pawn_attacks(side, squares[i]); break;
+                case knight: attacks = knight_attacks(squares[i]); break;
+                case bishop: attacks = bishop_attacks(squares[i], occupied); break;
+                case rook: attacks = rook_attacks(squares[i], occupied); break;
+                case queen: attacks = queen_attacks(squares[i], occupied); break;
+                default: attacks = king_attacks(squares[i]); break;
+            }
+            if (attacks & square_bb(kingSquare)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // decides a position at a ply if it's still undecided, returning if it was
+    bool decide(uint64_t index, int ply){
+        uint8_t expected = UNKNOWN;
+        return plies[index].compare_exchange_strong(expected, uint8_t(ply));
+    }
+
+    // gives every position of [first, last) its moves
+    void initialize(uint64_t first, uint64_t last){
+        vector<vector<uint32_t>> later(TB_MAX_PLIES + 1);
+        // the board is big because of its undo stack so it's kept off the thread's stack
+        unique_ptr<Board> board(new Board());
+        vector<uint64_t> inside;
+        int squares[TB_MAX_PIECES];
+        TileOwner side;
+        for (uint64_t index = first; index < last; index++){
+            layout.decode(index, squares, side);
+            // an index a position only gets through another symmetry or with the kings side by side is unused
+            if (layout.encode(squares, side) != index || !possible(squares, side)){
+                plies[index] = IMPOSSIBLE;
+                continue;
+            }
+            board->clear();
+            for (int i = 0; i < count; i++){
+                board->put_piece(order[i].owner, order[i].type, squares[i]);
+            }
+            board->set_side_to_move(side);
+            MoveList moves;
+            generate_legal_moves(*board, moves);
+            plies[index] = UNKNOWN;
+            lossFloor[index] = 0;
+            if (moves.size() == 0){
+                if (board->in_check()){
+                    later[0].push_back(uint32_t(index));
+                } else {
+                    plies[index] = DRAWN;
+                }
+                continue;
+            }
+            // indexes the moves staying inside the table lead to
+            inside.clear();
+            bool drawingMove = false;
+            int fastestWin = TB_MAX_PLIES + 1;
+            for (Move move: moves){
+                board->make_move(move);
+                if (!is_capture(move) && !is_promotion(move)){
+                    inside.push_back(layout.index(*board, false));
+                    board->unmake_move(move);
+                    continue;
+                }
+                uint8_t value;
+                bool found = tables.probe(*board, value);
+                string missing = found ? "" : tb_signature(*board);
+                board->unmake_move(move);
+                if (!found){
+                    throw runtime_error("table " + tb_canonical(missing) + " is needed to build " + signature);
+                }
+                if (value == 0){
+                    drawingMove = true;
+                } else if ((value - 1) % 2 == 0){
+                    fastestWin = min(fastestWin, int(value));
+                } else {
+                    lossFloor[index] = max(int(lossFloor[index]), int(value));
+                }
+            }
+            sort(inside.begin(), inside.end());
+            int insideCount = int(unique(inside.begin(), inside.end()) - inside.begin());
+            // a position with a winning or drawing way out can't be lost, so its count never reaches zero
+            bool wayOut = drawingMove || fastestWin <= TB_MAX_PLIES;
+            if (fastestWin <= TB_MAX_PLIES){
+                later[fastestWin].push_back(uint32_t(index));
+            }
+            remaining[index] = uint8_t(insideCount + wayOut);
+            if (insideCount + wayOut == 0){
+                later[lossFloor[index]].push_back(uint32_t(index));
+            }
+        }
+        add_pending(later);
+    }
+
+    void add_pending(vector<vector<uint32_t>> &later){
+        lock_guard<mutex> guard(pendingLock);
+        for (int ply = 0; ply <= TB_MAX_PLIES; ply++){
+            pending[ply].insert(pending[ply].end(), later[ply].begin(), later[ply].end());
+        }
+    }
+
+    // unmoves the positions decided at a ply, returning the positions that get decided a ply later
+    vector<uint32_t> expand(const uint32_t *frontier, size_t frontierSize, int ply){
+        vector<uint32_t> next;
+        vector<vector<uint32_t>> later(TB_MAX_PLIES + 1);
+        vector<uint64_t> befores;
+        int squares[TB_MAX_PIECES];
+        TileOwner side;
+        for (size_t n = 0; n < frontierSize; n++){
+            layout.decode(frontier[n], squares, side);
+            // the team that moved into this position
+            TileOwner mover = TileOwner(side ^ 1);
+            Bitboard occupied = 0;
+            for (int i = 0; i < count; i++){
+                occupied |= square_bb(squares[i]);
+            }
+            for (int i = 0; i < count; i++){
+                if (order[i].owner != mover){
+                    continue;
+                }
+                int to = squares[i];
+                Bitboard origins = 0;
+                switch (order[i].type){
+                    case pawn:{
+                        // pawns only move forward so they come from behind, white's pawns moving up the board
+                        int back = mover == white ? 8 : -8;
+                        int startRow = mover == white ? 6 : 1;
+                        int row = square_x(to) + (mover == white ? 1 : -1);
+                        if (row != 7 && row != 0 && !(occupied & square_bb(to + back))){
+                            origins |= square_bb(to + back);
+                            if (square_x(to) == startRow + 2 * (mover == white ? -1 : 1)
+                                && !(occupied & square_bb(to + 2 * back))){
+                                origins |= square_bb(to + 2 * back);
+                            }
+                        }
+                        break;
+                    }
+                    case knight: origins = knight_attacks(to); break;
+                    case bishop: origins = bishop_attacks(to, occupied); break;
+                    case rook: origins = rook_attacks(to, occupied); break;
+                    case queen: origins = queen_attacks(to, occupied); break;
+                    default: origins = king_attacks(to); break;
+                }
+                origins &= ~occupied;
+                while (origins){
+                    squares[i] = pop_lsb(origins);
+                    if (possible(squares, mover)){
+                        befores.push_back(layout.encode(squares, mover));
+                    }
+                }
+                squares[i] = to;
+            }
+            // a position reaching this one by several moves counted it once
+            sort(befores.begin(), befores.end());
+            befores.erase(unique(befores.begin(), befores.end()), befores.end());
+            for (uint64_t before: befores){
+                if (plies[before].load(memory_order_relaxed) != UNKNOWN){
+                    continue;
+                }
+                if (ply % 2 == 0){
+                    // moving into a lost position wins
+                    if (decide(before, ply + 1)){
+                        next.push_back(uint32_t(before));
+                    }
+                } else if (remaining[before].fetch_sub(1) == 1){
+                    // every move leads into a won position, the slowest of them being this one
+                    // unless a capture or promotion loses more slowly
+                    if (lossFloor[before] > ply + 1){
+                        later[lossFloor[before]].push_back(uint32_t(before));
+                    } else if (decide(before, ply + 1)){
+                        next.push_back(uint32_t(before));
+                    }
+                }
+            }
+            befores.clear();
+        }
+        add_pending(later);
+        return next;
+    }
+
+    public:
+    // tables holds the tables captures and promotions lead into
+    // throws std::invalid_argument if the signature isn't a valid material set
+    TablebaseGenerator(const TablebaseSet &tables, const string &signature, int threads)
+        : tables(tables), signature(signature), layout(signature), order(layout.pieces()),
+          count(int(order.size())), size{layout.size()}, threads{threads}, plies(new atomic<uint8_t>[size]),
+          remaining(new atomic<uint8_t>[size]), lossFloor(new uint8_t[size]), pending(TB_MAX_PLIES + 1) {}
+
+    // works out every position of the table
+    // throws std::runtime_error if a table captures or promotions lead into is missing
+    // or a mate is longer than a table byte can hold
+    void generate(){
+        vector<exception_ptr> errors(threads);
+        parallel_for(threads, size, [&](int id, uint64_t first, uint64_t last){
+            try{
+                initialize(first, last);
+            } catch (...){
+                errors[id] = current_exception();
+            }
+        });
+        for (exception_ptr &error: errors){
+            if (error){
+                rethrow_exception(error);
+            }
+        }
+
+        vector<uint32_t> frontier;
+        for (int ply = 0; ply <= TB_MAX_PLIES; ply++){
+            for (uint32_t index: pending[ply]){
+                if (decide(index, ply)){
+                    frontier.push_back(index);
+                }
+            }
+            vector<uint32_t>().swap(pending[ply]);
+            if (frontier.empty()){
+                continue;
+            }
+            if (ply == TB_MAX_PLIES){
+                throw runtime_error(signature + " has mates longer than " + to_string(TB_MAX_PLIES) + " plies");
+            }
+            vector<vector<uint32_t>> nexts(threads);
+            parallel_for(threads, frontier.size(), [&](int id, uint64_t first, uint64_t last){
+                nexts[id] = expand(frontier.data() + first, last - first, ply);
+            });
+            frontier.clear();
+            for (const vector<uint32_t> &next: nexts){
+                frontier.insert(frontier.end(), next.begin(), next.end());
+            }
+        }
+    }
+
+    // writes the table through a writable mapping of the file, renamed into place once complete
+    // throws std::runtime_error if the file can't be written
+    void write(const string &path){
+        string partial = path + ".partial";
+        int fd = open(partial.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0){
+            throw runtime_error("can't open " + partial);
+        }
+        size_t fileSize = TB_HEADER_SIZE + size;
+        if (ftruncate(fd, fileSize) != 0){
+            close(fd);
+            throw runtime_error("can't resize " + partial);
+        }
+        void *mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED){
+            throw runtime_error("can't map " + partial);
+        }
+        uint8_t *bytes = static_cast<uint8_t *>(mapping);
+        memset(bytes, 0, TB_HEADER_SIZE);
+        memcpy(bytes, TB_MAGIC, sizeof(TB_MAGIC));
+        memcpy(bytes + sizeof(TB_MAGIC), signature.data(), signature.size());
+        uint8_t *values = bytes + TB_HEADER_SIZE;
+        parallel_for(threads, size, [&](int, uint64_t first, uint64_t last){
+            for (uint64_t index = first; index < last; index++){
+                uint8_t ply = plies[index].load(memory_order_relaxed);
+                values[index] = ply <= TB_MAX_PLIES ? ply + 1 : 0;
+            }
+        });
+        bool synced = msync(mapping, fileSize, MS_SYNC) == 0;
+        munmap(mapping, fileSize);
+        if (!synced || rename(partial.c_str(), path.c_str()) != 0){
+            throw runtime_error("failed writing " + path);
+        }
+    }
+
+    // prints how the positions of the table turned out
+    void report(double seconds) const{
+        uint64_t wins = 0;
+        uint64_t losses = 0;
+        uint64_t draws = 0;
+        int longest = 0;
+        for (uint64_t index = 0; index < size; index++){
+            uint8_t ply = plies[index].load(memory_order_relaxed);
+            if (ply == IMPOSSIBLE){
+                continue;
+            } else if (ply > TB_MAX_PLIES){
+                draws++;
+            } else {
+                (ply % 2 ? wins : losses)++;
+                longest = max(longest, int(ply));
+            }
+        }
+        cout << signature << ": " << wins << " won, " << draws << " drawn, " << losses << " lost, longest mate "
+             << longest << " plies  " << seconds << "s  " << uint64_t(size / max(seconds, 1e-9))
+             << " positions/s" << endl;
+    }
+};
+
+// returns the tables a table's captures and promotions lead into, by canonical signature
+set<string> dependencies(const string &signature){
+    set<string> found;
+    size_t split = signature.find('v');
+    for (size_t i = 0; i < signature.size(); i++){
+        if (i == 0 || i == split || i == split + 1){
+            continue;
+        }
+        string captured = signature.substr(0, i) + signature.substr(i + 1);
+        if (captured.size() > 3){
+            found.insert(tb_canonical(captured));
+        }
+        if (signature[i] == 'P'){
+            for (const char *symbol = TB_PIECE_ORDER; *symbol != 'P'; symbol++){
+                string promoted = signature;
+                promoted[i] = *symbol;
+                // keeps the team's pieces in signature order
+                size_t teamEnd = i < split ? split : promoted.size();
+                size_t teamStart = i < split ? 1 : split + 2;
+                sort(promoted.begin() + teamStart, promoted.begin() + teamEnd, [](char a, char b){
+                    return strchr(TB_PIECE_ORDER, a) < strchr(TB_PIECE_ORDER, b);
+                });
+                found.insert(tb_canonical(promoted));
+            }
+        }
+    }
+    return found;
+}
+
+// returns every table of up to TB_MAX_PIECES pieces
+vector<string> all_signatures(){
+    vector<string> signatures;
+    for (const char *a = TB_PIECE_ORDER; *a; a++){
+        signatures.push_back(string("K") + *a + "vK");
+        for (const char *b = a; *b; b++){
+            signatures.push_back(string("K") + *a + *b + "vK");
+            signatures.push_back(string("K") + *a + "vK" + *b);
+        }
+    }
+    return signatures;
+}
+
+// usage: tb_gen <directory> [--threads N] [signature...]
+// builds endgame tables by retrograde analysis on N threads(all cores by default), writing one
+// <signature>.tb file per material set into the directory
+// every table of 3 and 4 pieces is built without signatures, otherwise the tables named, ex. KQvKR,
+// each along with the tables its captures and promotions lead into
+// tables already in the directory are used as they are
+int main(int argc, char *argv[]){
+    if (argc < 2){
+        cerr << "usage: tb_gen <directory> [--threads N] [signature...]" << endl;
+        return 1;
+    }
+    string directory = argv[1];
+    int threads = max(int(thread::hardware_concurrency()), 1);
+    vector<string> wanted;
+    for (int i = 2; i < argc; i++){
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+            threads = max(stoi(argv[++i]), 1);
+        } else {
+            wanted.push_back(argv[i]);
+        }
+    }
+    if (wanted.empty()){
+        wanted = all_signatures();
+    }
+
+    try{
+        // adds the tables each wanted table depends on until nothing new turns up
+        set<string> needed;
+        vector<string> unexplored;
+        for (const string &signature: wanted){
+            tb_pieces(signature);
+            unexplored.push_back(tb_canonical(signature));
+        }
+        while (!unexplored.empty()){
+            string signature = unexplored.back();
+            unexplored.pop_back();
+            if (needed.insert(signature).second){
+                for (const string &dependency: dependencies(signature)){
+                    unexplored.push_back(dependency);
+                }
+            }
+        }
+        // fewer pieces first, then fewer pawns, which builds every table after the ones it leads into
+        vector<string> plan(needed.begin(), needed.end());
+        stable_sort(plan.begin(), plan.end(), [](const string &a, const string &b){
+            size_t aPawns = count(a.begin(), a.end(), 'P');
+            size_t bPawns = count(b.begin(), b.end(), 'P');
+            return a.size() != b.size() ? a.size() < b.size() : aPawns < bPawns;
+        });
+
+        TablebaseSet tables;
+        tables.load_directory(directory);
+        for (const string &signature: plan){
+            if (tables.contains(signature)){
+                cout << signature << ": already built" << endl;
+                continue;
+            }
+            auto start = chrono::steady_clock::now();
+            string path = directory + "/" + signature + ".tb";
+            {
+                TablebaseGenerator generator(tables, signature, threads);
+                generator.generate();
+                generator.write(path);
+                generator.report(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            }
+            tables.add(unique_ptr<Tablebase>(new Tablebase(path)));
+        }
+    } catch (const exception &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,452 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "game.hpp"
+#include "engine_player.hpp"
+using namespace std;
+
+const string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// how one of the two engines of the match plays
+// the network, book and tables are loaded once and only read by the games, so every game shares them
+struct EngineConfig{
+    string name;
+    SearchLimits limits;
+    // milliseconds, a clock is used when clockBase is above 0
+    int64_t clockBase = 0;
+    int64_t clockIncrement = 0;
+    size_t hash = 16;
+    bool useNetwork = false;
+    string networkFile;
+    string bookFile;
+    string tablebaseDirectory;
+    shared_ptr<NnueNetwork> network;
+    shared_ptr<OpeningBook> book;
+    shared_ptr<TablebaseSet> tablebases;
+
+    // loads the files the engine plays with
+    // throws std::runtime_error if any of them can't be read
+    void load(){
+        if (useNetwork){
+            network.reset(networkFile.empty() ? new NnueNetwork() : new NnueNetwork(networkFile));
+        }
+        if (!bookFile.empty()){
+            book.reset(new OpeningBook(bookFile));
+        }
+        if (!tablebaseDirectory.empty()){
+            tablebases.reset(new TablebaseSet());
+            tablebases->load_directory(tablebaseDirectory);
+        }
+    }
+
+    EnginePlayer *make_player(const string &team) const{
+        EnginePlayer *player = new EnginePlayer(team, name, limits);
+        player->set_hash_size(hash);
+        player->set_network(network.get());
+        player->set_book(book.get());
+        player->set_tablebases(tablebases.get());
+        if (clockBase > 0){
+            player->set_clock(clockBase, clockIncrement);
+        }
+        return player;
+    }
+};
+
+// sets a time control of BASE+INCREMENT seconds, ex. "10+0.1"
+// throws std::invalid_argument if it isn't written that way
+void set_time_control(EngineConfig &config, const string &control){
+    size_t plus = control.find('+');
+    config.clockBase = int64_t(stod(control.substr(0, plus)) * 1000);
+    config.clockIncrement = plus == string::npos ? 0 : int64_t(stod(control.substr(plus + 1)) * 1000);
+    if (config.clockBase <= 0 || config.clockIncrement < 0){
+        throw invalid_argument("bad time control " + control);
+    }
+    config.limits.moveTime = 0;
+    config.limits.depth = MAX_PLY - 1;
+}
+
+// reads an engine from a comma separated list of settings, ex. "name=nnue,nnue,depth=6", on top of
+// the settings given for both engines
+// settings are name=NAME, depth=N, movetime=MS, tc=BASE+INC, hash=MB, nnue or nnue=FILE, book=FILE
+// and tablebases=DIR, a time or clock lifting the depth limit unless a depth comes after it
+// throws std::invalid_argument on anything else
+EngineConfig parse_engine(const string &text, const EngineConfig &defaults){
+    EngineConfig config = defaults;
+    istringstream settings(text);
+    string setting;
+    while (getline(settings, setting, ',')){
+        size_t equals = setting.find('=');
+        string key = setting.substr(0, equals);
+        string value = equals == string::npos ? "" : setting.substr(equals + 1);
+        if (key == "name"){
+            config.name = value;
+        } else if (key == "depth"){
+            config.limits.depth = max(1, min(stoi(value), MAX_PLY - 1));
+        } else if (key == "movetime"){
+            config.limits.moveTime = stoll(value);
+            config.limits.depth = MAX_PLY - 1;
+            config.clockBase = 0;
+        } else if (key == "tc"){
+            set_time_control(config, value);
+        } else if (key == "hash"){
+            config.hash = max(1, stoi(value));
+        } else if (key == "nnue"){
+            config.useNetwork = true;
+            config.networkFile = value;
+        } else if (key == "book"){
+            config.bookFile = value;
+        } else if (key == "tablebases"){
+            config.tablebaseDirectory = value;
+        } else {
+            throw invalid_argument("unknown engine setting " + setting);
+        }
+    }
+    return config;
+}
+
+// reads the start positions of the games from a file in the format of chess --batch: a line of
+// moves from the standard start, ex. "e2e4 e7e5", or "fen <fen> [moves ...]", or a bare FEN
+// lines starting with # are skipped
+// throws std::invalid_argument on an illegal move or position and std::runtime_error if the file can't be read
+vector<string> read_openings(const string &path){
+    ifstream file(path);
+    if (!file){
+        throw runtime_error("can't open " + path);
+    }
+    vector<string> openings;
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line)){
+        lineNumber++;
+        istringstream words(line);
+        string word;
+        if (!(words >> word) || word[0] == '#'){
+            continue;
+        }
+        string fen = START_FEN;
+        if (word == "fen" || word.find('/') != string::npos){
+            fen = word == "fen" ? "" : word;
+            while (words >> word && word != "moves"){
+                fen += (fen.empty() ? "" : " ") + word;
+            }
+        } else {
+            words.seekg(0);
+        }
+        unique_ptr<Board> board(new Board(fen));
+        while (words >> word){
+            MoveList moves;
+            generate_legal_moves(*board, moves);
+            bool found = false;
+            for (Move move: moves){
+                if (move_to_string(move) == word){
+                    board->play_move(move);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found){
+                throw invalid_argument("illegal move " + word + " in opening on line " + to_string(lineNumber));
+            }
+        }
+        // both piece sets must be possible to set up, ex. one king each
+        Game check(unique_ptr<Player>(new Player("white", "")), unique_ptr<Player>(new Player("red", "")), board->fen());
+        openings.push_back(board->fen());
+    }
+    if (openings.empty()){
+        throw runtime_error("no openings in " + path);
+    }
+    return openings;
+}
+
+// count openings made of plies random moves from the standard start, the same ones every run
+// lines ending the game early are replayed with the next random moves
+vector<string> random_openings(int count, int plies){
+    mt19937_64 random(2024);
+    unique_ptr<Board> board(new Board());
+    vector<string> openings;
+    while (int(openings.size()) < count){
+        *board = Board();
+        bool over = false;
+        for (int ply = 0; ply < plies && !over; ply++){
+            MoveList moves;
+            generate_legal_moves(*board, moves);
+            over = moves.size() == 0;
+            if (!over){
+                board->play_move(moves[random() % moves.size()]);
+            }
+        }
+        MoveList moves;
+        generate_legal_moves(*board, moves);
+        if (!over && moves.size() > 0){
+            openings.push_back(board->fen());
+        }
+    }
+    return openings;
+}
+
+// results of the games a thread played, from the first engine's side
+// only the thread playing the games writes them, and the main thread reads them to report the
+// match as it goes and adds them up at the end, so the games share no other mutable state
+struct alignas(64) ThreadTally{
+    atomic<int> wins{0};
+    atomic<int> draws{0};
+    atomic<int> losses{0};
+    atomic<int> unfinished{0};
+    atomic<int> timeLosses{0};
+    atomic<uint64_t> plies{0};
+};
+
+// wins, draws and losses of the first engine over the games so far
+struct MatchScore{
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+    int unfinished = 0;
+    int timeLosses = 0;
+    uint64_t plies = 0;
+
+    int games() const{
+        return wins + draws + losses;
+    }
+
+    // share of the points the first engine scored
+    double score() const{
+        return games() == 0 ? 0.5 : (wins + draws / 2.0) / games();
+    }
+
+    // variance of the points of one game
+    double variance() const{
+        if (games() == 0){
+            return 0;
+        }
+        double s = score();
+        return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+    }
+};
+
+double score_to_elo(double score){
+    score = min(max(score, 1e-6), 1 - 1e-6);
+    return 400 * log10(score / (1 - score));
+}
+
+double elo_to_score(double elo){
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+// sequential probability ratio test of the hypotheses that the first engine is elo0(H0) or
+// elo1(H1) stronger, with false positive rate alpha and false negative rate beta
+// the log likelihood ratio uses the normal approximation of the game scores
+struct Sprt{
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+
+    double lower_bound() const{
+        return log(beta / (1 - alpha));
+    }
+
+    double upper_bound() const{
+        return log((1 - beta) / alpha);
+    }
+
+    double llr(const MatchScore &score) const{
+        double variance = score.variance();
+        if (variance <= 0){
+            return 0;
+        }
+        double s0 = elo_to_score(elo0);
+        double s1 = elo_to_score(elo1);
+        return score.games() * (s1 - s0) * (2 * score.score() - s0 - s1) / (2 * variance);
+    }
+};
+
+// one line with the score, the Elo difference with its 95% interval and, when testing, the SPRT state
+string report_line(const MatchScore &score, const Sprt *sprt){
+    double deviation = sqrt(score.variance() / max(score.games(), 1));
+    double elo = score_to_elo(score.score());
+    double margin = (score_to_elo(score.score() + 1.96 * deviation) - score_to_elo(score.score() - 1.96 * deviation)) / 2;
+    ostringstream line;
+    line << fixed << setprecision(1) << "games " << score.games() << ": +" << score.wins << " -" << score.losses
+         << " =" << score.draws << "  score " << score.score() * 100 << "%  elo " << elo << " +- " << margin;
+    if (sprt){
+        line << setprecision(2) << "  llr " << sprt->llr(score) << " (" << sprt->lower_bound() << ", "
+             << sprt->upper_bound() << ")";
+    }
+    return line.str();
+}
+
+// usage: tournament [--games N] [--concurrency T] [--openings FILE | --random-plies N] [--depth N]
+//                   [--movetime MS] [--tc BASE+INC] [--hash MB] [--engine SETTINGS] [--engine SETTINGS]
+//                   [--sprt ELO0 ELO1] [--alpha A] [--beta B]
+// plays N(default 100) games between two engines, T(default all cores) games at a time, each game
+// on its own thread with its own players and board
+// the games go in pairs from the same opening with the colors swapped, the openings coming in turn
+// from a file or made of N(default 8) random plies
+// every game is searched to a depth(default 4), for MS milliseconds a move or on a clock of BASE
+// seconds plus INC seconds a move, unless the engine's own settings say otherwise
+// --engine sets up the first, then the second engine, see parse_engine for the settings
+// --sprt stops the match as soon as the test accepts either hypothesis
+int main(int argc, char *argv[]){
+    int gameCount = 100;
+    int concurrency = max(1, int(thread::hardware_concurrency()));
+    string openingFile;
+    int randomPlies = 8;
+    EngineConfig defaults;
+    defaults.limits.depth = 4;
+    vector<string> engineSettings;
+    bool testing = false;
+    Sprt sprt;
+    try{
+        for (int i = 1; i < argc; i++){
+            if (strcmp(argv[i], "--games") == 0 && i + 1 < argc){
+                gameCount = max(1, stoi(argv[++i]));
+            } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc){
+                concurrency = max(1, stoi(argv[++i]));
+            } else if (strcmp(argv[i], "--openings") == 0 && i + 1 < argc){
+                openingFile = argv[++i];
+            } else if (strcmp(argv[i], "--random-plies") == 0 && i + 1 < argc){
+                randomPlies = max(0, stoi(argv[++i]));
+            } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc){
+                defaults.limits.depth = max(1, min(stoi(argv[++i]), MAX_PLY - 1));
+            } else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc){
+                defaults.limits.moveTime = stoll(argv[++i]);
+                defaults.limits.depth = MAX_PLY - 1;
+                defaults.clockBase = 0;
+            } else if (strcmp(argv[i], "--tc") == 0 && i + 1 < argc){
+                set_time_control(defaults, argv[++i]);
+            } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc){
+                defaults.hash = max(1, stoi(argv[++i]));
+            } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc){
+                engineSettings.push_back(argv[++i]);
+            } else if (strcmp(argv[i], "--sprt") == 0 && i + 2 < argc){
+                testing = true;
+                sprt.elo0 = stod(argv[++i]);
+                sprt.elo1 = stod(argv[++i]);
+            } else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc){
+                sprt.alpha = stod(argv[++i]);
+            } else if (strcmp(argv[i], "--beta") == 0 && i + 1 < argc){
+                sprt.beta = stod(argv[++i]);
+            } else {
+                throw invalid_argument(string("unknown argument ") + argv[i]);
+            }
+        }
+        if (engineSettings.size() > 2){
+            throw invalid_argument("a match is between two engines");
+        }
+    } catch (const invalid_argument &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    EngineConfig engines[2];
+    vector<string> openings;
+    try{
+        for (int e = 0; e < 2; e++){
+            defaults.name = e == 0 ? "first" : "second";
+            engines[e] = parse_engine(e < int(engineSettings.size()) ? engineSettings[e] : "", defaults);
+            engines[e].load();
+        }
+        openings = openingFile.empty() ? random_openings((gameCount + 1) / 2, randomPlies) : read_openings(openingFile);
+    } catch (const exception &error){
+        cerr << error.what() << endl;
+        return 1;
+    }
+    concurrency = min(concurrency, gameCount);
+    cout << engines[0].name << " vs " << engines[1].name << ": " << gameCount << " games, " << concurrency
+         << " at a time, " << openings.size() << " openings" << endl;
+
+    // thread t plays games t, t + T, t + 2T... so the threads need nothing to hand out games
+    vector<ThreadTally> tallies(concurrency);
+    atomic<bool> stop{false};
+    atomic<int> running{concurrency};
+    auto play = [&](int id){
+        ThreadTally &tally = tallies[id];
+        for (int game = id; game < gameCount && !stop; game += concurrency){
+            // the first engine takes white in the first game of each pair
+            bool firstIsWhite = game % 2 == 0;
+            EnginePlayer *first = engines[0].make_player(firstIsWhite ? "white" : "red");
+            EnginePlayer *second = engines[1].make_player(firstIsWhite ? "red" : "white");
+            const string &fen = openings[(game / 2) % openings.size()];
+            Game match(unique_ptr<Player>(firstIsWhite ? first : second), unique_ptr<Player>(firstIsWhite ? second : first), fen);
+            match.set_display(false);
+            GameResult result = match.conduct_game();
+            tally.plies += result.plies;
+            if (result.score == "1/2-1/2"){
+                tally.draws++;
+            } else if (result.score == "1-0" || result.score == "0-1"){
+                (firstIsWhite == (result.score == "1-0") ? tally.wins : tally.losses)++;
+            } else if (first->out_of_time() || second->out_of_time()){
+                (first->out_of_time() ? tally.losses : tally.wins)++;
+                tally.timeLosses++;
+            } else {
+                tally.unfinished++;
+            }
+        }
+        running--;
+    };
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int id = 0; id < concurrency; id++){
+        pool.emplace_back(play, id);
+    }
+
+    // the match so far, reported whenever a game finishes
+    auto merge = [&](){
+        MatchScore score;
+        for (const ThreadTally &tally: tallies){
+            score.wins += tally.wins;
+            score.draws += tally.draws;
+            score.losses += tally.losses;
+            score.unfinished += tally.unfinished;
+            score.timeLosses += tally.timeLosses;
+            score.plies += tally.plies;
+        }
+        return score;
+    };
+    int reported = 0;
+    string decision;
+    while (running > 0){
+        this_thread::sleep_for(chrono::milliseconds(50));
+        MatchScore score = merge();
+        if (score.games() == reported){
+            continue;
+        }
+        reported = score.games();
+        cout << report_line(score, testing ? &sprt : nullptr) << endl;
+        if (testing && decision.empty()){
+            double llr = sprt.llr(score);
+            if (llr >= sprt.upper_bound() || llr <= sprt.lower_bound()){
+                decision = llr >= sprt.upper_bound() ? "H1 accepted" : "H0 accepted";
+                // games already started are played out and counted
+                stop = true;
+            }
+        }
+    }
+    for (thread &worker: pool){
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    MatchScore score = merge();
+    cout << "\n" << engines[0].name << " vs " << engines[1].name << "\n"
+         << report_line(score, testing ? &sprt : nullptr) << "\n";
+    if (testing){
+        cout << "sprt elo0 " << sprt.elo0 << " elo1 " << sprt.elo1 << " alpha " << sprt.alpha << " beta " << sprt.beta
+             << ": " << (decision.empty() ? "no decision" : decision) << "\n";
+    }
+    cout << score.timeLosses << " losses on time, " << score.unfinished << " unfinished\n"
+         << score.games() + score.unfinished << " games, " << score.plies << " plies in " << seconds << "s  "
+         << (score.games() + score.unfinished) / max(seconds, 1e-9) << " games/s  "
+         << uint64_t(score.plies / max(seconds, 1e-9)) << " plies/s" << endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#ifndef TT_HPP
+#define TT_HPP
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "move.hpp"
+
+// kind of score stored for a position
+enum Bound: uint8_t {noBound, upperBound, lowerBound, exactBound};
+
+// what a probe of the table found
+struct TTEntry{
+    Move move = NULL_MOVE;
+    int score = 0;
+    int depth = 0;
+    Bound bound = noBound;
+};
+
+// transposition table shared by every search thread without any locking
+// each slot holds the entry data packed into 64 bits and the hash key xored with that data
+// a slot torn by two threads writing at once no longer xors back to its key, so it reads as a miss
+// instead of handing one position's score to another
+class TranspositionTable{
+    struct Slot{
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask = 0;
+    // bumped every search so entries left over from earlier searches are replaced first
+    uint8_t generation = 0;
+
+    // data layout: move bits 0-15, score bits 16-31, depth bits 32-39, bound bits 40-41,
+    // generation bits 42-47
+    static uint64_t pack(Move move, int score, int depth, Bound bound, uint8_t generation){
+        return uint64_t(move) | uint64_t(uint16_t(int16_t(score))) << 16 | uint64_t(uint8_t(depth)) << 32
+            | uint64_t(bound) << 40 | uint64_t(generation & 63) << 42;
+    }
+
+    static int data_depth(uint64_t data){
+        return int(uint8_t(data >> 32));
+    }
+
+    static uint8_t data_generation(uint64_t data){
+        return uint8_t((data >> 42) & 63);
+    }
+
+    public:
+    explicit TranspositionTable(size_t megabytes = 16){
+        resize(megabytes);
+    }
+
+    // reallocates the table to the largest power of two number of slots that fits, clearing it
+    void resize(size_t megabytes){
+        size_t count = 1;
+        while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024){
+            count *= 2;
+        }
+        slots.reset(new Slot[count]);
+        mask = count - 1;
+        clear();
+    }
+
+    // must not be called while a search is running
+    void clear(){
+        for (uint64_t i = 0; i <= mask; i++){
+            slots[i].check.store(0, std::memory_order_relaxed);
+            slots[i].data.store(0, std::memory_order_relaxed);
+        }
+        generation = 0;
+    }
+
+    void new_search(){
+        generation = (generation + 1) & 63;
+    }
+
+    // returns if the position was found, filling entry
+    bool probe(uint64_t key, TTEntry &entry) const{
+        const Slot &slot = slots[key & mask];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || data == 0){
+            return false;
+        }
+        entry.move = Move(data & 0xFFFF);
+        entry.score = int16_t(uint16_t(data >> 16));
+        entry.depth = data_depth(data);
+        entry.bound = Bound((data >> 40) & 3);
+        return true;
+    }
+
+    // stores a search result, replacing the slot unless it holds a deeper search of this search
+    // keeps the old best move when the new result has none
+    void store(uint64_t key, Move move, int score, int depth, Bound bound){
+        Slot &slot = slots[key & mask];
+        uint64_t old = slot.data.load(std::memory_order_relaxed);
+        bool samePosition = (slot.check.load(std::memory_order_relaxed) ^ old) == key;
+        if (!samePosition && old != 0 && data_generation(old) == generation
+            && data_depth(old) > depth && bound != exactBound){
+            return;
+        }
+        if (move == NULL_MOVE && samePosition){
+            move = Move(old & 0xFFFF);
+        }
+        uint64_t data = pack(move, score, depth, bound, generation);
+        slot.data.store(data, std::memory_order_relaxed);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    // per mille of slots used by the current search
+    int hashfull() const{
+        int used = 0;
+        for (uint64_t i = 0; i < 1000 && i <= mask; i++){
+            uint64_t data = slots[i].data.load(std::memory_order_relaxed);
+            used += data != 0 && data_generation(data) == generation;
+        }
+        return used;
+    }
+};
+
+#endif
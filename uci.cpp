@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "search.hpp"
+#include "opening_book.hpp"
+using namespace std;
+
+// universal chess interface front end so the engine can be driven by GUIs and tournament managers
+// reads commands from stdin and answers on stdout, searching on a worker thread so stop and quit
+// are handled while a search runs
+class UciEngine{
+    Search search;
+    // book moves are played without searching while the game is in the book
+    unique_ptr<OpeningBook> book;
+    TablebaseSet tablebases;
+    // the network evaluates positions when UseNNUE is set, EvalFile replacing the compiled in one
+    unique_ptr<NnueNetwork> network{new NnueNetwork()};
+    bool useNetwork = false;
+    mt19937_64 random{random_device{}()};
+    Board board;
+    // hash keys of the positions played before the current one, used to spot repetitions
+    vector<uint64_t> gameKeys;
+    // cleared when a position command can't be read, so go doesn't search a position the gui didn't mean
+    bool positionSet = true;
+    thread worker;
+    // an infinite search must not report its move until told to stop
+    mutex waitLock;
+    condition_variable waitCondition;
+    bool stopRequested = false;
+    mutex outputLock;
+
+    void send(const string &line){
+        lock_guard<mutex> guard(outputLock);
+        cout << line << endl;
+    }
+
+    // ends the running search, if any, and waits for it to report its move
+    void stop_search(){
+        if (worker.joinable()){
+            {
+                lock_guard<mutex> guard(waitLock);
+                stopRequested = true;
+            }
+            waitCondition.notify_all();
+            search.stop();
+            worker.join();
+        }
+    }
+
+    // position [startpos | fen <fen>] [moves <move>...]
+    // the position is only taken if the FEN and every move can be read, otherwise go refuses to search
+    void position(istringstream &words){
+        string word;
+        words >> word;
+        string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+        if (word == "fen"){
+            fen.clear();
+            while (words >> word && word != "moves"){
+                fen += (fen.empty() ? "" : " ") + word;
+            }
+        } else {
+            words >> word;
+        }
+        positionSet = false;
+        unique_ptr<Board> next(new Board());
+        vector<uint64_t> nextKeys;
+        try{
+            next->set_fen(fen);
+        } catch (const invalid_argument &error){
+            send(string("info string ") + error.what());
+            return;
+        }
+        bool moves = word == "moves";
+        while (moves && words >> word){
+            MoveList legal;
+            generate_legal_moves(*next, legal);
+            Move *found = find_if(legal.begin(), legal.end(), [&word](Move move){
+                return move_to_string(move) == word;
+            });
+            if (found == legal.end()){
+                send("info string illegal move " + word);
+                return;
+            }
+            nextKeys.push_back(next->hash_key());
+            next->play_move(*found);
+        }
+        board = *next;
+        gameKeys.swap(nextKeys);
+        positionSet = true;
+    }
+
+    // go [depth N] [movetime MS] [wtime MS] [btime MS] [winc MS] [binc MS] [movestogo N] [infinite]
+    void go(istringstream &words){
+        stop_search();
+        if (!positionSet){
+            send("info string no valid position set");
+            send("bestmove 0000");
+            return;
+        }
+        SearchLimits limits;
+        int64_t time[2] = {0, 0};
+        int64_t increment[2] = {0, 0};
+        int64_t movesToGo = 0;
+        bool infinite = false;
+        string word;
+        while (words >> word){
+            if (word == "depth"){
+                words >> limits.depth;
+                limits.depth = max(1, min(limits.depth, MAX_PLY - 1));
+            } else if (word == "movetime"){
+                words >> limits.moveTime;
+            } else if (word == "wtime"){
+                words >> time[white];
+            } else if (word == "btime"){
+                words >> time[red];
+            } else if (word == "winc"){
+                words >> increment[white];
+            } else if (word == "binc"){
+                words >> increment[red];
+            } else if (word == "movestogo"){
+                words >> movesToGo;
+            } else if (word == "infinite"){
+                infinite = true;
+            }
+        }
+        TileOwner us = board.side_to_move();
+        if (!infinite && limits.moveTime == 0 && time[us] > 0){
+            // spend an even share of the clock over the moves left, keeping a margin for overhead
+            int64_t share = time[us] / (movesToGo > 0 ? movesToGo + 1 : 30) + increment[us] * 3 / 4;
+            limits.moveTime = max<int64_t>(1, min(share, time[us] - 50));
+        }
+
+        Move bookMove = book && !infinite ? book->probe(board, random) : NULL_MOVE;
+        if (bookMove != NULL_MOVE){
+            send("bestmove " + move_to_string(bookMove));
+            return;
+        }
+        stopRequested = false;
+        search.prepare();
+        worker = thread([this, limits, infinite](){
+            SearchResult result = search.think(board, limits, gameKeys);
+            if (infinite){
+                unique_lock<mutex> guard(waitLock);
+                waitCondition.wait(guard, [this](){ return stopRequested; });
+            }
+            send("bestmove " + (result.bestMove == NULL_MOVE ? string("0000") : move_to_string(result.bestMove)));
+        });
+    }
+
+    void set_option(istringstream &words){
+        string word;
+        string name;
+        string value;
+        words >> word;
+        while (words >> word && word != "value"){
+            name += (name.empty() ? "" : " ") + word;
+        }
+        getline(words >> ws, value);
+        if (name == "BookFile"){
+            book.reset();
+            if (!value.empty() && value != "<empty>"){
+                try{
+                    book.reset(new OpeningBook(value));
+                } catch (const runtime_error &error){
+                    send(string("info string ") + error.what());
+                }
+            }
+        } else if (name == "TablebasePath"){
+            tablebases = TablebaseSet();
+            if (!value.empty() && value != "<empty>"){
+                try{
+                    size_t found = tablebases.load_directory(value);
+                    send("info string found " + to_string(found) + " tablebases");
+                } catch (const runtime_error &error){
+                    send(string("info string ") + error.what());
+                }
+            }
+        } else if (name == "EvalFile"){
+            try{
+                network.reset(value.empty() || value == "<empty>" ? new NnueNetwork() : new NnueNetwork(value));
+            } catch (const runtime_error &error){
+                send(string("info string ") + error.what());
+                network.reset(new NnueNetwork());
+            }
+            search.set_network(useNetwork ? network.get() : nullptr);
+        } else if (name == "UseNNUE"){
+            useNetwork = value == "true";
+            search.set_network(useNetwork ? network.get() : nullptr);
+        } else if (name == "Threads" || name == "Hash"){
+            int number;
+            try{
+                number = max(1, stoi(value));
+            } catch (const logic_error &){
+                // stoi throws invalid_argument for a value that isn't a number and out_of_range for a huge one
+                send("info string invalid value for " + name + ": " + value);
+                return;
+            }
+            if (name == "Threads"){
+                search.set_threads(number);
+            } else {
+                search.set_hash_size(number);
+            }
+        }
+    }
+
+    public:
+    UciEngine(){
+        search.set_tablebases(&tablebases);
+        search.set_info_callback([this](const SearchInfo &info){
+            ostringstream line;
+            line << "info depth " << info.depth << " score ";
+            if (abs(info.score) >= MATE_BOUND){
+                int moves = (MATE_SCORE - abs(info.score) + 1) / 2;
+                line << "mate " << (info.score > 0 ? moves : -moves);
+            } else {
+                line << "cp " << info.score;
+            }
+            line << " nodes " << info.nodes << " nps " << uint64_t(info.nodes / max(info.seconds, 1e-9))
+                 << " time " << int64_t(info.seconds * 1000) << " pv";
+            for (Move move: info.pv){
+                line << " " << move_to_string(move);
+            }
+            send(line.str());
+        });
+    }
+
+    ~UciEngine(){
+        stop_search();
+    }
+
+    // handles commands until quit or the end of the input
+    void loop(){
+        string line;
+        while (getline(cin, line)){
+            istringstream words(line);
+            string command;
+            words >> command;
+            if (command == "uci"){
+                send("id name Chess by Larry Tingles");
+                send("id author Larry Tingles");
+                send("option name Threads type spin default 1 min 1 max 256");
+                send("option name Hash type spin default 16 min 1 max 65536");
+                send("option name BookFile type string default <empty>");
+                send("option name TablebasePath type string default <empty>");
+                send("option name UseNNUE type check default false");
+                send("option name EvalFile type string default <empty>");
+                send("uciok");
+            } else if (command == "isready"){
+                send("readyok");
+            } else if (command == "ucinewgame"){
+                stop_search();
+                search.clear_hash();
+            } else if (command == "setoption"){
+                stop_search();
+                set_option(words);
+            } else if (command == "position"){
+                stop_search();
+                position(words);
+            } else if (command == "go"){
+                go(words);
+            } else if (command == "stop"){
+                stop_search();
+            } else if (command == "quit"){
+                break;
+            }
+        }
+    }
+};
+
+int main(){
+    UciEngine engine;
+    engine.loop();
+}
@@ -0,0 +1,47 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+#include <cstdint>
+
+// random keys xored together to form the 64 bit hash key of a position
+// one key per piece type and team on each square, one for red to move,
+// one per combination of castling rights and one per en passant column
+struct ZobristKeys{
+    uint64_t pieces[2][6][64];
+    uint64_t castling[16];
+    uint64_t epColumn[8];
+    uint64_t redToMove;
+};
+
+// fills the keys from a fixed seed at compile time so every build and run hashes positions the same way
+constexpr ZobristKeys build_zobrist_keys(){
+    ZobristKeys keys{};
+    uint64_t seed = 0x2C1B3C6D5A4F7E19ull;
+    auto next = [&seed](){
+        // splitmix64
+        seed += 0x9E3779B97F4A7C15ull;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+    for (auto &team: keys.pieces){
+        for (auto &type: team){
+            for (auto &key: type){
+                key = next();
+            }
+        }
+    }
+    // no castling rights adds nothing to the key
+    for (int rights = 1; rights < 16; rights++){
+        keys.castling[rights] = next();
+    }
+    for (auto &key: keys.epColumn){
+        key = next();
+    }
+    keys.redToMove = next();
+    return keys;
+}
+
+inline constexpr ZobristKeys ZOBRIST = build_zobrist_keys();
+
+#endif